@@ -0,0 +1,462 @@
+// Benchmark harness of the Cordon solvers: sweeps problem sizes, input shapes, thread counts and backends, checks
+// every run against a sequential baseline and writes one JSON object per measurement (JSON lines), so that results
+// of different releases can be compared with -compare.
+//
+//   ./bench -problem lcs -n 100000,1000000 -k 10,1000 -sigma 4 -threads 1,4,16 -out results.jsonl
+//   ./bench -problem all -compare results.jsonl -tolerance 0.1
+//
+// Inputs are generated from -seed, so two runs with the same arguments measure the same inputs. Parlay and OpenCilk
+// fix their worker count at start-up, so every thread count of -threads runs in a child process started with
+// OMP_NUM_THREADS, PARLAY_NUM_THREADS and CILK_NWORKERS set to it.
+#include <omp.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "glws.h"
+#include "lcs.h"
+#include "lis.h"
+#include "segment_tree_cilk.h"
+#include "segment_tree_cilk_opt.h"
+#include "tournament_tree.h"
+#include "utils.h"
+
+struct Options {
+    std::string problem = "all";
+    std::vector<long> sizes = {100000, 1000000};
+    std::vector<long> lengths = {10, 1000};  // LIS length, planted LCS length
+    std::vector<long> alphabets = {4, 64};   // Alphabet of the uniform LCS inputs, i.e. match density 1 / sigma
+    std::vector<long> threads;               // Empty: the thread count of the environment
+    std::vector<std::string> backends;       // Empty: every backend of the problem
+    int reps = 5;
+    int warmup = 1;
+    int granularity = AUTO_GRANULARITY;
+    unsigned int seed = 1;
+    std::string out;
+    std::string compare;
+    double tolerance = 0.1;
+    bool worker = false;  // Run in the current process only, as a child of a -threads sweep
+};
+
+struct Timing {
+    double min = 0, median = 0, mean = 0;
+};
+
+// Time f over opts.reps repetitions after opts.warmup untimed ones; setup runs before every call and is not timed
+Timing measure(const Options& opts, const std::function<void()>& setup, const std::function<void()>& f) {
+    for (int r = 0; r < opts.warmup; ++r) {
+        setup();
+        f();
+    }
+    std::vector<double> times;
+    for (int r = 0; r < std::max(opts.reps, 1); ++r) {
+        setup();
+        auto start = std::chrono::steady_clock::now();
+        f();
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    Timing t;
+    t.min = times.front();
+    t.median = times[times.size() / 2];
+    for (double x : times) t.mean += x / times.size();
+    return t;
+}
+
+class Writer {
+  public:
+    explicit Writer(const std::string& path) {
+        if (!path.empty()) file.open(path, std::ios::app);
+    }
+
+    // One flat JSON object per line; fields are written in the order given
+    void write(const std::vector<std::pair<std::string, std::string>>& fields) {
+        std::ostringstream line;
+        line << "{";
+        for (size_t i = 0; i < fields.size(); ++i) {
+            line << (i ? ", " : "") << "\"" << fields[i].first << "\": " << fields[i].second;
+        }
+        line << "}\n";
+        (file.is_open() ? static_cast<std::ostream&>(file) : std::cout) << line.str() << std::flush;
+    }
+
+  private:
+    std::ofstream file;
+};
+
+std::string quoted(const std::string& s) { return "\"" + s + "\""; }
+
+template <typename V>
+std::string number(V v) {
+    std::ostringstream s;
+    s << v;
+    return s.str();
+}
+
+bool selected(const Options& opts, const std::string& backend) {
+    const auto& names = opts.backends;
+    return names.empty() || std::find(names.begin(), names.end(), backend) != names.end();
+}
+
+int current_threads() { return omp_get_max_threads(); }
+
+// Common fields of a measurement, followed by the problem-specific ones
+void report(Writer& writer, const Options& opts, const std::string& problem, const std::string& backend,
+            std::vector<std::pair<std::string, std::string>> shape, long result, long expected, const Timing& t,
+            const std::string& baseline, double baseline_ms) {
+    std::vector<std::pair<std::string, std::string>> fields = {{"problem", quoted(problem)},
+                                                               {"backend", quoted(backend)}};
+    fields.insert(fields.end(), shape.begin(), shape.end());
+    fields.insert(fields.end(), {{"threads", number(current_threads())},
+                                 {"reps", number(opts.reps)},
+                                 {"warmup", number(opts.warmup)},
+                                 {"seed", number(opts.seed)},
+                                 {"result", number(result)},
+                                 {"expected", number(expected)},
+                                 {"correct", result == expected ? "true" : "false"},
+                                 {"min_ms", number(t.min)},
+                                 {"median_ms", number(t.median)},
+                                 {"mean_ms", number(t.mean)},
+                                 {"baseline", quoted(baseline)},
+                                 {"baseline_ms", number(baseline_ms)},
+                                 {"speedup", number(t.median > 0 ? baseline_ms / t.median : 0)}});
+    writer.write(fields);
+    std::cerr << problem << " " << backend << " threads=" << current_threads() << " median=" << t.median
+              << "ms speedup=" << (t.median > 0 ? baseline_ms / t.median : 0)
+              << (result == expected ? "" : " WRONG RESULT") << std::endl;
+}
+
+template <typename TreeType>
+void bench_lis_backend(Writer& writer, const Options& opts, const std::string& backend, bool parallel,
+                       const std::vector<int>& input, const std::vector<std::pair<std::string, std::string>>& shape,
+                       int expected, double baseline_ms) {
+    if (!selected(opts, backend)) return;
+    LIS<int, std::less<int>, TreeType> lis;
+    int result = 0;
+    Timing t = measure(opts, [] {}, [&] { result = lis.compute(input, parallel, opts.granularity); });
+    report(writer, opts, "lis", backend, shape, result, expected, t, "patience", baseline_ms);
+}
+
+void bench_lis(Writer& writer, const Options& opts) {
+    for (long n : opts.sizes) {
+        for (long k : opts.lengths) {
+            if (k > n) continue;
+            std::vector<int> input = generateLIS(n, k, opts.seed);
+            int expected = 0;
+            Timing baseline = measure(opts, [] {}, [&] { expected = lis_patience(input); });
+            std::vector<std::pair<std::string, std::string>> shape = {{"n", number(n)}, {"k", number(k)}};
+            bench_lis_backend<SegmentTree<int, SequentialScheduler>>(writer, opts, "sequential", false, input, shape,
+                                                                      expected, baseline.median);
+            bench_lis_backend<SegmentTreeOpenMP<int>>(writer, opts, "openmp", true, input, shape, expected,
+                                                      baseline.median);
+            bench_lis_backend<SegmentTreeCilk<int>>(writer, opts, "cilk", true, input, shape, expected,
+                                                    baseline.median);
+            bench_lis_backend<SegmentTreeCilkOpt<int>>(writer, opts, "parlay", true, input, shape, expected,
+                                                       baseline.median);
+            bench_lis_backend<TournamentTree<int>>(writer, opts, "tournament", true, input, shape, expected,
+                                                   baseline.median);
+        }
+    }
+}
+
+// Weighted LIS on the inputs of bench_lis with seeded weights, against the sequential Fenwick tree
+void bench_lis_weighted(Writer& writer, const Options& opts) {
+    for (long n : opts.sizes) {
+        for (long k : opts.lengths) {
+            if (k > n) continue;
+            std::vector<int> input = generateLIS(n, k, opts.seed);
+            std::mt19937 gen(opts.seed);
+            std::vector<long> weights(n);
+            for (auto& w : weights) w = gen() % 1000;
+            long expected = 0;
+            Timing baseline = measure(opts, [] {}, [&] { expected = lis_weighted_fenwick(input, weights); });
+            std::vector<std::pair<std::string, std::string>> shape = {{"n", number(n)}, {"k", number(k)}};
+            LIS<int> lis;
+            LIS<int, std::less<int>, TournamentTree<int>> tournament;
+            auto run = [&](const std::string& backend, const std::function<long()>& f) {
+                if (!selected(opts, backend)) return;
+                long result = 0;
+                Timing t = measure(opts, [] {}, [&] { result = f(); });
+                report(writer, opts, "lis_weighted", backend, shape, result, expected, t, "fenwick", baseline.median);
+            };
+            run("sequential", [&] { return lis.compute_weighted(input, weights, false, opts.granularity); });
+            run("openmp", [&] { return lis.compute_weighted(input, weights, true, opts.granularity); });
+            run("tournament", [&] { return tournament.compute_weighted(input, weights, true, opts.granularity); });
+        }
+    }
+}
+
+// The LCS backends run on arrows built once per input, so that they compare the rounds only; bit_parallel, which
+// needs no arrows, runs on the sequences
+void bench_lcs_input(Writer& writer, const Options& opts, const std::vector<int>& a, const std::vector<int>& b,
+                     std::vector<std::pair<std::string, std::string>> shape) {
+    BitParallelLCS<int> bit_parallel;
+    int expected = 0;
+    Timing baseline = measure(opts, [] {}, [&] { expected = bit_parallel.compute(a, b, false); });
+    ArrowsCSR<> arrows = build_arrows(a, b);
+    shape.push_back({"arrows", number(arrows.nnz())});
+
+    LCS<int> lcs;
+    ArrowsCSR<> rows;
+    auto copy = [&] { rows = arrows; };
+    auto run = [&](const std::string& backend, const std::function<int()>& f, bool fresh) {
+        if (!selected(opts, backend)) return;
+        int result = 0;
+        Timing t = measure(opts, fresh ? std::function<void()>(copy) : [] {}, [&] { result = f(); });
+        report(writer, opts, "lcs", backend, shape, result, expected, t, "bit_parallel_sequential", baseline.median);
+    };
+    int g = opts.granularity;
+    run("sequential", [&] { return lcs.compute_arrows(std::move(rows), ParallelArch::NONE, false, g); }, true);
+    run("openmp", [&] { return lcs.compute_arrows(std::move(rows), ParallelArch::OPENMP, true, g); }, true);
+    run("cilk", [&] { return lcs.compute_arrows(std::move(rows), ParallelArch::CILK, true, g); }, true);
+    run("parlay", [&] { return lcs.compute_arrows_paralay(arrows, true, g); }, false);
+    run("cilk_opt", [&] { return lcs.compute_arrows_opt(std::move(rows), true, g); }, true);
+    run("tournament", [&] { return lcs.compute_arrows(std::move(rows), ParallelArch::TOURNAMENT, true, g); }, true);
+    run("bit_parallel", [&] { return bit_parallel.compute(a, b, true); }, false);
+}
+
+void bench_lcs(Writer& writer, const Options& opts) {
+    for (long n : opts.sizes) {
+        // Planted LCS of length k with sparse arrows
+        for (long k : opts.lengths) {
+            if (k > n) continue;
+            auto [a, b] = generateLCSSequences(n, n, k, opts.seed);
+            bench_lcs_input(writer, opts, a, b, {{"n", number(n)}, {"m", number(n)}, {"k", number(k)}, {"sigma", "0"}});
+        }
+        // Uniform symbols over sigma values, n * n / sigma arrows; skipped where the arrows would not fit in memory
+        for (long sigma : opts.alphabets) {
+            if (static_cast<double>(n) * n / sigma > 5e8) continue;
+            std::mt19937 gen(opts.seed);
+            std::vector<int> a(n), b(n);
+            for (auto& x : a) x = gen() % sigma;
+            for (auto& x : b) x = gen() % sigma;
+            bench_lcs_input(writer, opts, a, b,
+                            {{"n", number(n)}, {"m", number(n)}, {"k", "0"}, {"sigma", number(sigma)}});
+        }
+    }
+}
+
+// The O(n^2) post-office DP of test_glws.cpp over the same prefix-sum cost, the sequential GLWS baseline
+long double glws_reference(const std::vector<long double>& pos, long double build) {
+    size_t n = pos.size();
+    std::vector<long double> prefix(n + 1, 0), E(n + 1, 0);
+    for (size_t i = 1; i <= n; ++i) prefix[i] = prefix[i - 1] + pos[i - 1];
+    for (size_t j = 1; j <= n; ++j) {
+        E[j] = std::numeric_limits<long double>::max();
+        for (size_t i = 0; i < j; ++i) {
+            size_t l = i + 1, mid = (l + j) / 2;
+            long double median = pos[mid - 1];
+            long double cost = median * (mid - l + 1) - (prefix[mid] - prefix[l - 1]) +
+                               (prefix[j] - prefix[mid]) - median * (j - mid);
+            E[j] = std::min(E[j], E[i] + cost + build);
+        }
+    }
+    return E[n];
+}
+
+void bench_glws(Writer& writer, const Options& opts) {
+    const long double build = 10;
+    for (long n : opts.sizes) {
+        std::mt19937 gen(opts.seed);
+        std::vector<long double> pos(n);
+        long double current = gen() % 10;
+        for (auto& x : pos) x = current += 1 + gen() % 5;
+
+        // The quadratic baseline is only run where it finishes in seconds
+        long expected = -1;
+        double baseline_ms = 0;
+        if (n <= 20000) {
+            long double cost = 0;
+            Timing baseline = measure(opts, [] {}, [&] { cost = glws_reference(pos, build); });
+            expected = static_cast<long>(cost);
+            baseline_ms = baseline.median;
+        }
+        for (auto [backend, search] : {std::pair{"binary_search", CordonSearch::BINARY_SEARCH},
+                                       std::pair{"linear", CordonSearch::LINEAR}}) {
+            if (!selected(opts, backend)) continue;
+            ConvexGLWS<long double, PostOfficeCost<long double>> glws(search, opts.granularity);
+            long double cost = 0;
+            Timing t = measure(opts, [] {}, [&] { cost = glws.compute(pos, PostOfficeCost<long double>(build)); });
+            long result = expected < 0 ? -1 : static_cast<long>(cost);
+            report(writer, opts, "glws", backend, {{"n", number(n)}}, result, expected, t,
+                   expected < 0 ? "none" : "quadratic_dp", baseline_ms);
+        }
+    }
+}
+
+// Fields of a JSON line written by Writer, as raw strings
+std::map<std::string, std::string> parse_line(const std::string& line) {
+    std::map<std::string, std::string> fields;
+    size_t i = 0;
+    while ((i = line.find('"', i)) != std::string::npos) {
+        size_t end = line.find('"', i + 1);
+        if (end == std::string::npos) break;
+        std::string key = line.substr(i + 1, end - i - 1);
+        size_t colon = line.find(':', end);
+        if (colon == std::string::npos) break;
+        size_t start = line.find_first_not_of(' ', colon + 1);
+        size_t stop = line[start] == '"' ? line.find('"', start + 1) + 1 : line.find_first_of(",}", start);
+        fields[key] = line.substr(start, stop - start);
+        i = stop;
+    }
+    return fields;
+}
+
+// The configuration of a measurement, e.g. "lcs parlay n=100000 m=100000 k=10 sigma=0 threads=4"
+std::string record_key(const std::map<std::string, std::string>& r) {
+    std::string key;
+    for (const char* field : {"problem", "backend", "n", "m", "k", "sigma", "threads"}) {
+        auto it = r.find(field);
+        if (it == r.end()) continue;
+        std::string value = it->second;
+        value.erase(std::remove(value.begin(), value.end(), '"'), value.end());
+        bool named = std::strcmp(field, "problem") != 0 && std::strcmp(field, "backend") != 0;
+        key += (key.empty() ? "" : " ") + (named ? std::string(field) + "=" : "") + value;
+    }
+    return key;
+}
+
+// Compare the medians of two result files; returns the number of regressions and wrong results
+int compare_results(const std::string& before, const std::string& after, double tolerance) {
+    std::map<std::string, double> old;
+    std::ifstream in(before);
+    std::string line;
+    while (std::getline(in, line)) {
+        auto r = parse_line(line);
+        if (!r.empty()) old[record_key(r)] = std::atof(r["median_ms"].c_str());
+    }
+    int failures = 0;
+    std::ifstream now(after);
+    while (std::getline(now, line)) {
+        auto r = parse_line(line);
+        if (r.empty()) continue;
+        std::string key = record_key(r);
+        double median = std::atof(r["median_ms"].c_str());
+        if (r["correct"] == "false") {
+            std::cout << "WRONG    " << key << std::endl;
+            failures++;
+        } else if (old.count(key) && median > old[key] * (1 + tolerance)) {
+            std::cout << "SLOWER   " << key << ": " << old[key] << "ms -> " << median << "ms" << std::endl;
+            failures++;
+        } else if (old.count(key) && median < old[key] * (1 - tolerance)) {
+            std::cout << "FASTER   " << key << ": " << old[key] << "ms -> " << median << "ms" << std::endl;
+        }
+    }
+    return failures;
+}
+
+std::vector<long> parse_list(const char* arg) {
+    std::vector<long> values;
+    std::stringstream s(arg);
+    std::string item;
+    while (std::getline(s, item, ',')) values.push_back(std::atol(item.c_str()));
+    return values;
+}
+
+void printUsage() {
+    std::cout << "Usage: ./bench [-problem lis|lis_weighted|lcs|glws|all] [-n list] [-k list] [-sigma list]"
+              << " [-threads list]"
+              << std::endl;
+    std::cout << "  -problem: the problems to run (default: all)" << std::endl;
+    std::cout << "  -n: comma-separated input sizes (default: 100000,1000000)" << std::endl;
+    std::cout << "  -k: LIS lengths and planted LCS lengths (default: 10,1000)" << std::endl;
+    std::cout << "  -sigma: alphabet sizes of the uniform LCS inputs, 0 for none (default: 4,64)" << std::endl;
+    std::cout << "  -threads: thread counts, each run in a child process (default: the environment)" << std::endl;
+    std::cout << "  -backend: comma-separated backends, e.g. openmp,cilk,parlay,cilk_opt,tournament,sequential"
+              << std::endl;
+    std::cout << "  -reps, -warmup: timed and untimed repetitions (default: 5, 1)" << std::endl;
+    std::cout << "  -g: granularity, or auto (default: auto)" << std::endl;
+    std::cout << "  -seed: seed of the input generators (default: 1)" << std::endl;
+    std::cout << "  -out: write the JSON lines to a file instead of stdout" << std::endl;
+    std::cout << "  -compare: earlier results; exits with 1 if a median grew by more than -tolerance (default: 0.1) "
+                 "or a result is wrong"
+              << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    Options opts;
+    std::vector<std::string> forwarded;  // Arguments passed on to the children of a -threads sweep
+    for (int i = 1; i < argc; i++) {
+        bool value = i + 1 < argc;
+        if (strcmp(argv[i], "-problem") == 0 && value) {
+            opts.problem = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && value) {
+            opts.sizes = parse_list(argv[++i]);
+        } else if (strcmp(argv[i], "-k") == 0 && value) {
+            opts.lengths = parse_list(argv[++i]);
+        } else if (strcmp(argv[i], "-sigma") == 0 && value) {
+            opts.alphabets = parse_list(argv[++i]);
+            opts.alphabets.erase(std::remove(opts.alphabets.begin(), opts.alphabets.end(), 0), opts.alphabets.end());
+        } else if (strcmp(argv[i], "-threads") == 0 && value) {
+            opts.threads = parse_list(argv[++i]);
+            continue;
+        } else if (strcmp(argv[i], "-backend") == 0 && value) {
+            std::stringstream s(argv[++i]);
+            std::string item;
+            while (std::getline(s, item, ',')) opts.backends.push_back(item);
+        } else if (strcmp(argv[i], "-reps") == 0 && value) {
+            opts.reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-warmup") == 0 && value) {
+            opts.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-g") == 0 && value) {
+            opts.granularity = strcmp(argv[i + 1], "auto") == 0 ? AUTO_GRANULARITY : atoi(argv[i + 1]);
+            i++;
+        } else if (strcmp(argv[i], "-seed") == 0 && value) {
+            opts.seed = static_cast<unsigned int>(std::atol(argv[++i]));
+        } else if (strcmp(argv[i], "-out") == 0 && value) {
+            opts.out = argv[++i];
+        } else if (strcmp(argv[i], "-compare") == 0 && value) {
+            opts.compare = argv[++i];
+            continue;
+        } else if (strcmp(argv[i], "-tolerance") == 0 && value) {
+            opts.tolerance = std::atof(argv[++i]);
+            continue;
+        } else if (strcmp(argv[i], "-worker") == 0) {
+            opts.worker = true;
+            continue;
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            printUsage();
+            return 0;
+        } else {
+            std::cout << "Invalid argument: " << argv[i] << std::endl;
+            printUsage();
+            return 1;
+        }
+        forwarded.push_back(argv[i - 1]);
+        forwarded.push_back(argv[i]);
+    }
+    if (!opts.compare.empty() && opts.out.empty()) {
+        std::cout << "-compare needs -out, the file the new results are written to" << std::endl;
+        return 1;
+    }
+
+    // The children of a sweep append to the file the parent started
+    if (!opts.out.empty() && !opts.worker) std::ofstream(opts.out, std::ios::trunc);
+    if (!opts.threads.empty() && !opts.worker) {
+        for (long t : opts.threads) {
+            std::string command = "OMP_NUM_THREADS=" + number(t) + " PARLAY_NUM_THREADS=" + number(t) +
+                                  " CILK_NWORKERS=" + number(t) + " '" + argv[0] + "' -worker";
+            for (const auto& arg : forwarded) command += " '" + arg + "'";
+            if (std::system(command.c_str()) != 0) return 1;
+        }
+    } else {
+        Writer writer(opts.out);
+        if (opts.problem == "lis" || opts.problem == "all") bench_lis(writer, opts);
+        if (opts.problem == "lis_weighted" || opts.problem == "all") bench_lis_weighted(writer, opts);
+        if (opts.problem == "lcs" || opts.problem == "all") bench_lcs(writer, opts);
+        if (opts.problem == "glws" || opts.problem == "all") bench_glws(writer, opts);
+    }
+
+    if (!opts.compare.empty() && !opts.worker) return compare_results(opts.compare, opts.out, opts.tolerance) ? 1 : 0;
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <fcntl.h>
+#include <omp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "arrows.h"
+
+/**
+ * @brief Binary arrow files: a 64-byte header followed by the n + 1 CSR offsets and the column array of ArrowsCSR.
+ *
+ * Both arrays are stored exactly as they lie in memory, so load_arrows maps the file and hands the rows to the trees
+ * without parsing or copying them, and pages are only read when a tree touches them. The header records the format
+ * version, the byte order and the widths of offsets and columns, and a checksum of both arrays; a file written by
+ * another version or machine is rejected instead of misread.
+ */
+struct ArrowFileHeader {
+  static constexpr char MAGIC[8] = {'P', 'D', 'P', 'A', 'R', 'R', 'O', 'W'};
+  static constexpr uint32_t VERSION = 1;
+  static constexpr uint32_t ENDIAN_MARK = 0x01020304;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;    // ENDIAN_MARK in the byte order of the writer
+  uint32_t offset_bytes;  // Width of one offset
+  uint32_t column_bytes;  // Width of one column
+  uint64_t rows;
+  uint64_t nnz;
+  uint64_t checksum;  // arrow_checksum of the offsets and columns
+  uint64_t reserved[2];
+};
+static_assert(sizeof(ArrowFileHeader) == 64, "The arrays must start 8-byte aligned");
+
+/**
+ * @brief Checksum of a byte range, computed in parallel over blocks of 1 MiB
+ *
+ * Every block is hashed with 64-bit FNV-1a over 8-byte words and the block hashes, mixed with their index, are summed,
+ * so the result does not depend on the number of threads.
+ */
+inline uint64_t arrow_checksum(const unsigned char *data, size_t bytes, bool parallel = true) {
+  constexpr size_t BLOCK = 1 << 20;
+  size_t blocks = (bytes + BLOCK - 1) / BLOCK;
+  uint64_t sum = 0;
+#pragma omp parallel for reduction(+ : sum) if (parallel)
+  for (size_t b = 0; b < blocks; ++b) {
+    const unsigned char *first = data + b * BLOCK;
+    size_t size = std::min(BLOCK, bytes - b * BLOCK);
+    uint64_t hash = 0xcbf29ce484222325ull;
+    size_t k = 0;
+    for (; k + 8 <= size; k += 8) {
+      uint64_t word;
+      std::memcpy(&word, first + k, 8);
+      hash = (hash ^ word) * 0x100000001b3ull;
+    }
+    for (; k < size; ++k) hash = (hash ^ first[k]) * 0x100000001b3ull;
+    // splitmix64 finalizer, so that equal blocks at different positions do not cancel
+    uint64_t x = hash + (b + 1) * 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    sum += x ^ (x >> 31);
+  }
+  return sum;
+}
+
+/**
+ * @brief A whole file mapped into memory; unmapped and closed on destruction
+ */
+class MappedFile {
+ private:
+  int fd = -1;
+  void *address = MAP_FAILED;
+  size_t bytes = 0;
+
+ public:
+  /**
+   * @param path The file to map
+   * @param writable Create or truncate the file to bytes and map it for writing; otherwise map it read-only
+   * @param bytes The size of a writable file, ignored otherwise
+   * @throws std::runtime_error if the file cannot be opened or mapped
+   */
+  MappedFile(const std::string &path, bool writable, size_t bytes = 0) : bytes(bytes) {
+    fd = writable ? ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) : ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open " + path);
+    struct stat info;
+    if (writable ? ::ftruncate(fd, bytes) != 0 : ::fstat(fd, &info) != 0) {
+      ::close(fd);
+      throw std::runtime_error("Cannot size " + path);
+    }
+    if (!writable) this->bytes = static_cast<size_t>(info.st_size);
+    if (this->bytes > 0) {
+      address = ::mmap(nullptr, this->bytes, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                       writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    }
+    if (address == MAP_FAILED) {
+      ::close(fd);
+      throw std::runtime_error("Cannot map " + path);
+    }
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  ~MappedFile() {
+    ::munmap(address, bytes);
+    ::close(fd);
+  }
+
+  unsigned char *data() const { return static_cast<unsigned char *>(address); }
+
+  size_t size() const { return bytes; }
+};
+
+/**
+ * @brief Write arrows to a binary arrow file
+ *
+ * The file is sized up front, mapped, and both arrays are copied into it in parallel blocks. It is written under a
+ * temporary name and renamed into place, so readers never see a partial file.
+ *
+ * @param path The file to write
+ * @param arrows The arrows, owned or borrowed
+ * @param parallel Whether to copy and checksum the arrays in parallel
+ * @throws std::runtime_error if the file cannot be written
+ */
+template <typename V>
+void save_arrows(const std::string &path, const ArrowsCSR<V> &arrows, bool parallel = true) {
+  size_t offset_bytes = (arrows.size() + 1) * sizeof(size_t), column_bytes = arrows.nnz() * sizeof(V);
+  std::string temporary = path + ".tmp";
+  {
+    MappedFile file(temporary, true, sizeof(ArrowFileHeader) + offset_bytes + column_bytes);
+    unsigned char *payload = file.data() + sizeof(ArrowFileHeader);
+    auto copy = [&](unsigned char *out, const void *in, size_t bytes) {
+      constexpr size_t BLOCK = 1 << 20;
+      size_t blocks = (bytes + BLOCK - 1) / BLOCK;
+#pragma omp parallel for if (parallel)
+      for (size_t b = 0; b < blocks; ++b) {
+        std::memcpy(out + b * BLOCK, static_cast<const unsigned char *>(in) + b * BLOCK,
+                    std::min(BLOCK, bytes - b * BLOCK));
+      }
+    };
+    copy(payload, arrows.offsets_data(), offset_bytes);
+    copy(payload + offset_bytes, arrows.columns_data(), column_bytes);
+
+    ArrowFileHeader header{};
+    std::memcpy(header.magic, ArrowFileHeader::MAGIC, sizeof(header.magic));
+    header.version = ArrowFileHeader::VERSION;
+    header.byte_order = ArrowFileHeader::ENDIAN_MARK;
+    header.offset_bytes = sizeof(size_t);
+    header.column_bytes = sizeof(V);
+    header.rows = arrows.size();
+    header.nnz = arrows.nnz();
+    header.checksum = arrow_checksum(payload, offset_bytes + column_bytes, parallel);
+    std::memcpy(file.data(), &header, sizeof(header));
+  }
+  if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    throw std::runtime_error("Cannot write " + path);
+  }
+}
+
+/**
+ * @brief Open a binary arrow file written by save_arrows
+ *
+ * The returned container borrows the rows from the mapping, which stays alive as long as any copy of it does, so
+ * opening costs O(1) besides the optional checksum pass.
+ *
+ * @param path The file to open
+ * @param verify Whether to check the checksum, which reads the whole file once
+ * @return The arrows of the file
+ * @throws std::runtime_error if the file cannot be opened or is not a valid arrow file of this format and column type
+ */
+template <typename V = uint32_t>
+ArrowsCSR<V> load_arrows(const std::string &path, bool verify = true) {
+  auto file = std::make_shared<MappedFile>(path, false);
+  ArrowFileHeader header;
+  if (file->size() < sizeof(header)) throw std::runtime_error(path + " is not an arrow file");
+  std::memcpy(&header, file->data(), sizeof(header));
+  if (std::memcmp(header.magic, ArrowFileHeader::MAGIC, sizeof(header.magic)) != 0) {
+    throw std::runtime_error(path + " is not an arrow file");
+  }
+  if (header.version != ArrowFileHeader::VERSION || header.byte_order != ArrowFileHeader::ENDIAN_MARK ||
+      header.offset_bytes != sizeof(size_t) || header.column_bytes != sizeof(V)) {
+    throw std::runtime_error(path + " was written by another version, machine or column type");
+  }
+  // Bound the counts by the file size first, so that damaged ones cannot wrap the sizes below around
+  if (header.rows >= file->size() / sizeof(size_t) || header.nnz > (file->size() - sizeof(header)) / sizeof(V)) {
+    throw std::runtime_error(path + " is truncated");
+  }
+  size_t offset_bytes = (header.rows + 1) * sizeof(size_t), column_bytes = header.nnz * sizeof(V);
+  if (file->size() != sizeof(header) + offset_bytes + column_bytes) {
+    throw std::runtime_error(path + " is truncated");
+  }
+
+  const unsigned char *payload = file->data() + sizeof(header);
+  if (verify && arrow_checksum(payload, offset_bytes + column_bytes) != header.checksum) {
+    throw std::runtime_error(path + " fails its checksum");
+  }
+  auto offsets = reinterpret_cast<const size_t *>(payload);
+  auto columns = reinterpret_cast<const V *>(payload + offset_bytes);
+  if (offsets[0] != 0 || offsets[header.rows] != header.nnz) {
+    throw std::runtime_error(path + " has inconsistent offsets");
+  }
+  return ArrowsCSR<V>(std::move(file), header.rows, offsets, columns);
+}
\ No newline at end of file
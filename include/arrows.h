@@ -0,0 +1,252 @@
+#pragma once
+
+#include <omp.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "numa_placement.h"
+
+/**
+ * @brief Column type used to store arrows for a tree of value type T: 32-bit indices for integral trees, T otherwise
+ */
+template <typename T>
+using arrow_column_t = std::conditional_t<std::is_integral_v<T>, uint32_t, T>;
+
+/**
+ * @brief Compressed-sparse-row storage of LCS arrows.
+ *
+ * Row i holds the sorted columns j with A[i] == B[j]. All rows share one contiguous column array and are delimited by
+ * an offset array of n + 1 entries, so building the container costs two allocations instead of one per row, and the
+ * leaf walks of the segment trees stream through adjacent memory. Columns are kept uncompressed so that a row can
+ * still be binary searched from any position.
+ *
+ * The rows are either owned or borrowed from storage kept alive by a shared owner, e.g. a memory-mapped arrow file
+ * (see load_arrows): a borrowed container is read-only until the next assign(), which switches it back to owned rows.
+ *
+ * @tparam V The column type (32-bit indices by default)
+ */
+template <typename V = uint32_t>
+class ArrowsCSR {
+ public:
+  using value_type = V;
+
+  /**
+   * @brief Read-only view of one row, usable with the standard algorithms
+   */
+  class Row {
+   private:
+    const V *first;
+    const V *last;
+
+   public:
+    Row(const V *first, const V *last) : first(first), last(last) {}
+
+    const V *begin() const { return first; }
+
+    const V *end() const { return last; }
+
+    size_t size() const { return static_cast<size_t>(last - first); }
+
+    bool empty() const { return first == last; }
+
+    const V &operator[](size_t k) const { return first[k]; }
+  };
+
+ private:
+  first_touch_vector<size_t> offsets;    // Owned rows: row i occupies columns[offsets[i], offsets[i + 1])
+  first_touch_vector<V> columns;
+  std::shared_ptr<const void> borrowed;  // Keeps borrowed rows alive, null for owned rows
+  const size_t *offset_data = nullptr;   // The rows in use, owned or borrowed
+  const V *column_data = nullptr;
+  size_t rows = 0;
+
+  // Point the rows in use at the owned arrays
+  void own() {
+    borrowed.reset();
+    offset_data = offsets.data();
+    column_data = columns.data();
+    rows = offsets.size() - 1;
+  }
+
+ public:
+  ArrowsCSR() : offsets(1, 0) { own(); }
+
+  /**
+   * @brief Construct from prebuilt offset and column arrays
+   *
+   * @param offsets Row boundaries, n + 1 non-decreasing entries starting at 0 and ending at columns.size()
+   * @param columns Columns of all rows, concatenated in row order
+   * @throws std::invalid_argument if the offsets do not describe the column array
+   */
+  ArrowsCSR(first_touch_vector<size_t> offsets, first_touch_vector<V> columns)
+      : offsets(std::move(offsets)), columns(std::move(columns)) {
+    if (this->offsets.empty() || this->offsets.front() != 0 || this->offsets.back() != this->columns.size()) {
+      throw std::invalid_argument("Offsets do not match the column array");
+    }
+    own();
+  }
+
+  /**
+   * @brief Borrow rows stored elsewhere without copying them
+   *
+   * @param owner Keeps offsets and columns alive for as long as any container borrows them
+   * @param n The number of rows
+   * @param offsets Row boundaries, n + 1 non-decreasing entries starting at 0
+   * @param columns Columns of all rows, offsets[n] entries
+   * @throws std::invalid_argument if the offsets do not start at 0
+   */
+  ArrowsCSR(std::shared_ptr<const void> owner, size_t n, const size_t *offsets, const V *columns)
+      : offsets(1, 0), borrowed(std::move(owner)), offset_data(offsets), column_data(columns), rows(n) {
+    if (offsets[0] != 0) {
+      throw std::invalid_argument("Offsets do not start at 0");
+    }
+  }
+
+  ArrowsCSR(const ArrowsCSR &other)
+      : offsets(other.offsets),
+        columns(other.columns),
+        borrowed(other.borrowed),
+        offset_data(other.offset_data),
+        column_data(other.column_data),
+        rows(other.rows) {
+    if (!borrowed) own();
+  }
+
+  // Moving keeps the buffers of owned rows, so the pointers stay valid; the source is left empty
+  ArrowsCSR(ArrowsCSR &&other) noexcept
+      : offsets(std::move(other.offsets)),
+        columns(std::move(other.columns)),
+        borrowed(std::move(other.borrowed)),
+        offset_data(other.offset_data),
+        column_data(other.column_data),
+        rows(other.rows) {
+    other.offsets.assign(1, 0);
+    other.columns.clear();
+    other.own();
+  }
+
+  ArrowsCSR &operator=(ArrowsCSR other) noexcept {
+    swap(other);
+    return *this;
+  }
+
+  // Exchange the rows with other without allocating; the buffers of owned rows move along, so the pointers stay valid
+  void swap(ArrowsCSR &other) noexcept {
+    std::swap(offsets, other.offsets);
+    std::swap(columns, other.columns);
+    std::swap(borrowed, other.borrowed);
+    std::swap(offset_data, other.offset_data);
+    std::swap(column_data, other.column_data);
+    std::swap(rows, other.rows);
+  }
+
+  /**
+   * @brief Build from a nested container (std::vector<std::vector<...>>, parlay::sequence<parlay::sequence<...>>)
+   *
+   * Row sizes are counted and rows are copied in parallel; only the scan over the row sizes is sequential.
+   *
+   * @param rows The nested arrow rows, each sorted in ascending order
+   * @param first_row The first row to keep, e.g. 1 to drop the unused row 0 of 1-indexed inputs
+   * @return The CSR copy of rows[first_row..]
+   */
+  template <typename Nested>
+  static ArrowsCSR from_nested(const Nested &rows, size_t first_row = 0) {
+    size_t n = rows.size() > first_row ? rows.size() - first_row : 0;
+    ArrowsCSR arrows;
+    arrows.assign(
+        n, [&](size_t i) { return rows[first_row + i].size(); },
+        [&](size_t i, V *out) {
+          const auto &row = rows[first_row + i];
+          for (size_t k = 0; k < row.size(); ++k) {
+            out[k] = static_cast<V>(row[k]);
+          }
+        });
+    return arrows;
+  }
+
+  /**
+   * @brief Rebuild the rows in place, keeping the storage of earlier builds when it is large enough
+   *
+   * Borrowed rows are released and replaced by owned ones.
+   * Row sizes are counted and rows are written in parallel; only the scan over the row sizes is sequential. In NUMA
+   * mode the rows are written with a static schedule, so that the pages of a slice of rows are first written by the
+   * worker that walks the same slice of leaves.
+   *
+   * @param n The number of rows
+   * @param row_size row_size(i) returns the number of arrows of row i
+   * @param fill fill(i, out) writes the sorted columns of row i to out[0, row_size(i))
+   * @param parallel Whether the rows are counted and written in parallel
+   */
+  template <typename RowSize, typename Fill>
+  void assign(size_t n, RowSize row_size, Fill fill, bool parallel = true) {
+    bool numa = Numa::enabled();
+    offsets.resize(n + 1);
+    Numa::distribute(offsets.data(), n + 1);
+    offsets[0] = 0;
+
+#pragma omp parallel for schedule(static) if (parallel)
+    for (size_t i = 0; i < n; ++i) {
+      offsets[i + 1] = row_size(i);
+    }
+    for (size_t i = 0; i < n; ++i) {
+      offsets[i + 1] += offsets[i];
+    }
+
+    columns.resize(offsets[n]);
+    if (numa) {
+      Numa::distribute(columns.data(), columns.size());
+#pragma omp parallel for schedule(static) if (parallel)
+      for (size_t i = 0; i < n; ++i) {
+        fill(i, columns.data() + offsets[i]);
+      }
+    } else {
+#pragma omp parallel for schedule(dynamic, 64) if (parallel)
+      for (size_t i = 0; i < n; ++i) {
+        fill(i, columns.data() + offsets[i]);
+      }
+    }
+    own();
+  }
+
+  /**
+   * @brief Get the number of rows
+   */
+  size_t size() const { return rows; }
+
+  /**
+   * @brief Get the total number of arrows over all rows
+   */
+  size_t nnz() const { return offset_data[rows]; }
+
+  /**
+   * @brief Get the position of the first arrow of row i in the column array
+   */
+  size_t offset(size_t i) const { return offset_data[i]; }
+
+  /**
+   * @brief Get a view of row i
+   */
+  Row row(size_t i) const { return Row(column_data + offset_data[i], column_data + offset_data[i + 1]); }
+
+  Row operator[](size_t i) const { return row(i); }
+
+  /**
+   * @brief Get the n + 1 row boundaries
+   */
+  const size_t *offsets_data() const { return offset_data; }
+
+  /**
+   * @brief Get the columns of all rows, nnz() entries
+   */
+  const V *columns_data() const { return column_data; }
+
+  /**
+   * @brief Whether the rows are borrowed rather than owned
+   */
+  bool is_borrowed() const { return borrowed != nullptr; }
+};
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "parlay/parallel.h"
+
+/**
+ * @brief Throughput mode for batches of many independent problems.
+ *
+ * Splitting a small problem across workers costs more than it saves, so run() spreads whole problems over the parlay
+ * workers instead and solves each one sequentially. Work stealing balances problems of uneven size, helped by handing
+ * out the largest ones first, and every worker keeps one solver whose buffers are reused for all problems it takes.
+ *
+ * A problem holding more than one worker's share of the whole batch would leave the other workers idle once the rest
+ * is done. Such outliers run after the others, one at a time, with intra-problem parallelism.
+ */
+class Batch {
+ public:
+  // Problems smaller than this are never solved in parallel on their own
+  static constexpr size_t OUTLIER_MIN = 1 << 14;
+
+  /**
+   * @brief Whether a problem of the given work is solved on its own with intra-problem parallelism
+   *
+   * @param work The work of the problem
+   * @param total The work of the whole batch
+   * @param workers The number of workers
+   */
+  static bool is_outlier(size_t work, size_t total, size_t workers = parlay::num_workers()) {
+    return workers > 1 && work >= OUTLIER_MIN && work * workers > total;
+  }
+
+  /**
+   * @brief Solve every problem of a batch
+   *
+   * @tparam Solver A default-constructible solver; one is created per worker
+   * @param count The number of problems
+   * @param work work(i) estimates the work of problem i, e.g. its input size
+   * @param solve solve(solver, i, parallel) solves problem i with the given solver; parallel is only set for outliers
+   */
+  template <typename Solver, typename Work, typename Solve>
+  static void run(size_t count, Work work, Solve solve) {
+    size_t workers = parlay::num_workers();
+    std::vector<size_t> sizes(count);
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+      sizes[i] = work(i);
+      total += sizes[i];
+    }
+
+    std::vector<size_t> regular, outliers;
+    for (size_t i = 0; i < count; ++i) {
+      (is_outlier(sizes[i], total, workers) ? outliers : regular).push_back(i);
+    }
+    std::stable_sort(regular.begin(), regular.end(), [&](size_t x, size_t y) { return sizes[x] > sizes[y]; });
+
+    std::vector<Solver> solvers(workers);
+    parlay::parallel_for(0, regular.size(), [&](size_t k) { solve(solvers[parlay::worker_id()], regular[k], false); },
+                         1);
+    for (size_t i : outliers) solve(solvers[0], i, true);
+  }
+};
\ No newline at end of file
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "utils.h"
+
+/**
+ * @brief Compressed best-decision array used by the GLWS solvers.
+ *
+ * Stores the best decision of every state as a list of disjoint intervals sorted by their left boundary, so that the
+ * decision of a state can be found with a binary search instead of a linear scan. Adjacent intervals that share the
+ * same decision are merged on insertion, which keeps the list as short as the number of distinct decision runs.
+ */
+class DecisionList {
+ private:
+  std::vector<Interval> intervals;
+
+ public:
+  DecisionList() = default;
+
+  /**
+   * @brief Construct a list holding a single interval
+   *
+   * @param l Left boundary of the interval
+   * @param r Right boundary of the interval
+   * @param j Best decision of all states in [l, r]
+   */
+  DecisionList(int l, int r, int j) { intervals.push_back({l, r, j}); }
+
+  /**
+   * @brief Find the first interval that ends at or after state i
+   *
+   * @param i The state to look up
+   * @return The index of the first interval with r >= i, or size() if there is none
+   */
+  size_t lower_bound(int i) const {
+    auto it = std::lower_bound(intervals.begin(), intervals.end(), i,
+                               [](const Interval &interval, int state) { return interval.r < state; });
+    return static_cast<size_t>(it - intervals.begin());
+  }
+
+  /**
+   * @brief Find the position of the interval containing state i
+   *
+   * @param i The state to look up
+   * @return The index of the interval containing i, or size() if no interval covers i
+   */
+  size_t locate(int i) const {
+    size_t idx = lower_bound(i);
+    return (idx < intervals.size() && intervals[idx].l <= i) ? idx : intervals.size();
+  }
+
+  /**
+   * @brief Get the best decision of state i
+   *
+   * @param i The state to look up
+   * @return The best decision of i, or 0 if no interval covers i
+   */
+  int find(int i) const {
+    size_t idx = locate(i);
+    return idx < intervals.size() ? intervals[idx].j : 0;
+  }
+
+  /**
+   * @brief Append an interval to the end of the list, merging it with the last one if they share the same decision
+   *
+   * @param interval The interval to append; its left boundary must be greater than every stored right boundary
+   */
+  void push_back(const Interval &interval) {
+    if (!intervals.empty() && intervals.back().j == interval.j && intervals.back().r + 1 == interval.l) {
+      intervals.back().r = interval.r;
+    } else {
+      intervals.push_back(interval);
+    }
+  }
+
+  /**
+   * @brief Drop every state greater than r, clipping the interval that contains r
+   *
+   * @param r The last state to keep
+   */
+  void truncate(int r) {
+    while (!intervals.empty() && intervals.back().l > r) intervals.pop_back();
+    if (!intervals.empty() && intervals.back().r > r) intervals.back().r = r;
+  }
+
+  /**
+   * @brief Replace the decisions of all states from `from` onwards with the given intervals
+   *
+   * @param from The first state to overwrite
+   * @param tail Intervals sorted by their left boundary, starting at `from`
+   */
+  void splice(int from, const std::vector<Interval> &tail) {
+    truncate(from - 1);
+    for (const auto &interval : tail) push_back(interval);
+  }
+
+  /**
+   * @brief Replace the decisions of all states in [from, to] with a per-state decision array, compacting runs of equal
+   * decisions into single intervals
+   *
+   * @param from The first state to overwrite
+   * @param to The last state to overwrite
+   * @param decision Best decision of every state, indexed by state
+   */
+  void splice(int from, int to, const std::vector<int> &decision) {
+    truncate(from - 1);
+    for (int l = from, r = from; l <= to; l = r) {
+      while (r <= to && decision[r] == decision[l]) ++r;
+      push_back({l, r - 1, decision[l]});
+    }
+  }
+
+  /**
+   * @brief Replace the list with a single interval, keeping the storage of the previous one
+   */
+  void reset(int l, int r, int j) {
+    intervals.clear();
+    intervals.push_back({l, r, j});
+  }
+
+  void clear() { intervals.clear(); }
+
+  bool empty() const { return intervals.empty(); }
+
+  size_t size() const { return intervals.size(); }
+
+  const Interval &operator[](size_t idx) const { return intervals[idx]; }
+
+  std::vector<Interval>::const_iterator begin() const { return intervals.begin(); }
+
+  std::vector<Interval>::const_iterator end() const { return intervals.end(); }
+};
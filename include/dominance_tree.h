@@ -0,0 +1,150 @@
+#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "parlay/primitives.h"
+
+/**
+ * @brief Range-max tree for weighted LIS: query(i) is the largest value inserted at a state j < i with
+ * data[j] < data[i], or W() if there is none.
+ *
+ * The tree is keyed by value. The states are sorted by value, and level d splits that order into blocks of 2^d
+ * states, the top level holding all of them in one block. Every block keeps a Fenwick tree of prefix maxima over its
+ * states in index order. The states below data[i] are a prefix of the value order, reached from the top block by
+ * one path that takes every left child it covers whole; the states before i in a block are a prefix of the block
+ * too, and its length is carried from a block to its children through the number of states of the left child among
+ * every prefix of the block (fractional cascading), so no level needs a search. A query therefore costs O(log^2 n),
+ * and so does an insert, which raises one Fenwick path per level on the way down to its leaf with an atomic
+ * compare-and-swap. Inserts may run concurrently with each other but not with queries, which is what a batch of
+ * updates per dominance layer needs. The tree takes O(n log n) memory.
+ *
+ * Compare must be a strict weak order; states with equivalent values never dominate each other.
+ */
+template <typename T, typename W, typename Compare = std::less<T>>
+class DominanceTree {
+ private:
+  int n = 0;
+  int top = 0;                                            // Level of the block holding all states
+  std::vector<int> position;                              // position[i]: rank of state i in the value order
+  std::vector<int> below;                                 // below[i]: number of states with a value less than data[i]
+  std::vector<std::vector<int>> left;                     // left[d][start + k]: states of the left child among the
+                                                          // first k states of the block of level d at start
+  std::vector<std::unique_ptr<std::atomic<W>[]>> maxima;  // maxima[d]: the Fenwick trees of the blocks of level d
+
+  int length(int d, int start) const { return std::min(1 << d, n - start); }
+
+  // States of the left child among the first count states of the block of level d at start
+  int from_left(int d, int start, int count) const {
+    return count < length(d, start) ? left[d][start + count] : std::min(1 << (d - 1), n - start);
+  }
+
+  // Largest value among the first count states of the block of level d at start
+  W prefix(int d, int start, int count) const {
+    W best = W();
+    for (int k = count; k > 0; k -= k & -k) {
+      best = std::max(best, maxima[d][start + k - 1].load(std::memory_order_relaxed));
+    }
+    return best;
+  }
+
+  void raise(int d, int start, int k, W value) {
+    int end = length(d, start);
+    for (++k; k <= end; k += k & -k) {
+      std::atomic<W> &slot = maxima[d][start + k - 1];
+      W current = slot.load(std::memory_order_relaxed);
+      while (current < value && !slot.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+      }
+    }
+  }
+
+ public:
+  /**
+   * @brief Build the tree over the states of data, with every value W(); the blocks of a level are merged in parallel
+   */
+  DominanceTree(const std::vector<T> &data, bool parallel = false, Compare cmp = Compare())
+      : n(static_cast<int>(data.size())) {
+    auto order = parlay::stable_sort(parlay::tabulate(n, [](size_t i) { return static_cast<int>(i); }),
+                                     [&](int x, int y) { return cmp(data[x], data[y]); });
+    position.resize(n);
+    below.resize(n);
+#pragma omp parallel for schedule(static) if (parallel)
+    for (int p = 0; p < n; ++p) {
+      position[order[p]] = p;
+      below[order[p]] = static_cast<int>(
+          std::partition_point(order.begin(), order.begin() + p, [&](int j) { return cmp(data[j], data[order[p]]); }) -
+          order.begin());
+    }
+
+    while ((1LL << top) < n) top++;
+    left.resize(top + 1);
+    maxima.resize(top + 1);
+    // Merge the blocks level by level, the states of each block in index order
+    std::vector<int> lower(order.begin(), order.end()), upper(n);
+    for (int d = 1; d <= top; ++d) {
+      left[d].resize(n);
+      int width = 1 << d, count = (n + width - 1) / width;
+#pragma omp parallel for schedule(dynamic, 1) if (parallel && count > 1)
+      for (int b = 0; b < count; ++b) {
+        int start = b * width, mid = std::min(n, start + width / 2), end = std::min(n, start + width);
+        int x = start, y = mid;
+        for (int k = start; k < end; ++k) {
+          left[d][k] = x - start;
+          upper[k] = y == end || (x < mid && lower[x] < lower[y]) ? lower[x++] : lower[y++];
+        }
+      }
+      lower.swap(upper);
+    }
+    for (int d = 0; d <= top; ++d) {
+      maxima[d].reset(new std::atomic<W>[n]);
+#pragma omp parallel for schedule(static) if (parallel)
+      for (int k = 0; k < n; ++k) maxima[d][k].store(W(), std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Get the largest value inserted at a state j < i with data[j] < data[i], or W() if there is none
+   */
+  W query(int i) const {
+    W best = W();
+    // The states of the block before i, and the states of the block below data[i]
+    int start = 0, before = i, count = below[i];
+    for (int d = top; count > 0; --d) {
+      if (count == length(d, start)) return std::max(best, prefix(d, start, before));
+      int half = 1 << (d - 1), in_left = from_left(d, start, before);
+      if (count >= half) {
+        best = std::max(best, prefix(d - 1, start, in_left));
+        before -= in_left;
+        count -= half;
+        start += half;
+      } else {
+        before = in_left;
+      }
+    }
+    return best;
+  }
+
+  /**
+   * @brief Raise the value of state i to value; safe to call for many states at once
+   */
+  void insert(int i, W value) {
+    int p = position[i], start = 0, before = i;
+    for (int d = top; d >= 0; --d) {
+      raise(d, start, before, value);
+      if (d == 0) break;
+      int half = 1 << (d - 1), in_left = from_left(d, start, before);
+      if (p < start + half) {
+        before = in_left;
+      } else {
+        before -= in_left;
+        start += half;
+      }
+    }
+  }
+
+  int size() const { return n; }
+};
\ No newline at end of file
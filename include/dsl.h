@@ -1,21 +1,29 @@
 #pragma once
 
+#include <omp.h>
+#include <algorithm>
 #include <functional>
 #include <map>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <tuple>
 #include <variant>
 #include <vector>
+#include "batch.h"
 #include "glws.h"
 #include "lcs.h"
 #include "lis.h"
 #include "utils.h"
+#include "wavefront.h"
 
 namespace dp_dsl {
 
 // Enumeration for different DP problem types
-enum class ProblemType { LIS, LCS, CONVEX_GLWS, UNKNOWN };
+// GLWS is solved with the linear Cordon search, CONVEX_GLWS with the binary search that relies on a convex cost;
+// WEIGHTED_LIS is max(Status(J) + Element(w, I), Status(I)), element I of sequence w weighing it
+enum class ProblemType { LIS, LCS, CONVEX_GLWS, GLWS, WEIGHTED_LIS, UNKNOWN };
 
 // Enumeration for optimization objective
 enum class Objective { MAXIMIZE, MINIMIZE };
@@ -54,11 +62,12 @@ struct IndVar : Var {
   SingleDepVar *operator-(int v);
 };
 
+// base + offset, where base is an independent variable or a range variable (e.g. k + 1 for interval DP)
 struct SingleDepVar : Var {
-  IndVar *base;
+  Var *base;
   int offset;
 
-  SingleDepVar(IndVar *base, int offset) : Var(VarType::SINGLE_DEP), base(base), offset(offset) {}
+  SingleDepVar(Var *base, int offset) : Var(VarType::SINGLE_DEP), base(base), offset(offset) {}
 };
 
 struct RangeDepVar : Var {
@@ -94,12 +103,12 @@ SingleDepVar *IndVar::operator-(int v) {
   return res;
 }
 
-SingleDepVar *add(IndVar *v, int c) {
+SingleDepVar *add(Var *v, int c) {
   SingleDepVar *res = new SingleDepVar(v, c);
   return res;
 }
 
-SingleDepVar *minus(IndVar *v, int c) {
+SingleDepVar *minus(Var *v, int c) {
   SingleDepVar *res = new SingleDepVar(v, -c);
   return res;
 }
@@ -167,10 +176,25 @@ Val<T> index(Sequence<T> *seq, SingleDepVar *v) {
   return Val<T>(seq, dynamic_cast<Var *>(v));
 }
 
-enum class ExpressionType { MAX, MIN, NUMBER, STATUS, NONE };
-
+enum class ExpressionType { MAX, MIN, NUMBER, STATUS, SUM, ELEMENT, COST, NONE };
+
+/**
+ * @brief A node of a recurrence.
+ *
+ * Nodes are values sharing their immutable operands, so the helpers below can pass them around freely; the derived
+ * types only add constructors, which keeps slicing a Status or a Number into an Expression lossless.
+ *
+ * MAX and MIN take the best of their operands, over every value of the range variables that appear in them and are not
+ * bound further out. A reference to the state itself (Status(I) in max(Status(J) + 1, Status(I))) stands for the
+ * value relaxed so far and adds no candidate.
+ */
 struct Expression {
   ExpressionType type;
+  std::shared_ptr<const Expression> left;  // Operands of MAX, MIN and SUM
+  std::shared_ptr<const Expression> right;
+  std::vector<Var *> vars;  // Indices of STATUS, the index of ELEMENT, the arguments of COST
+  int value = 0;            // The NUMBER, or the sequence read by ELEMENT
+  int constant = 0;         // Added to the value of the node
 
   Expression(ExpressionType t) : type(t) {}
   Expression() : type(ExpressionType::NONE) {}
@@ -185,6 +209,12 @@ struct Expression {
         return "Number";
       case ExpressionType::STATUS:
         return "Status";
+      case ExpressionType::SUM:
+        return "Sum";
+      case ExpressionType::ELEMENT:
+        return "Element";
+      case ExpressionType::COST:
+        return "Cost";
       default:
         return "None";
     }
@@ -192,27 +222,22 @@ struct Expression {
 };
 
 struct TwoPartExpression : Expression {
-  Expression left;
-  Expression right;
-
-  TwoPartExpression(ExpressionType t, Expression l, Expression r) : Expression(t), left(l), right(r) {}
+  TwoPartExpression(ExpressionType t, const Expression &l, const Expression &r) : Expression(t) {
+    left = std::make_shared<const Expression>(l);
+    right = std::make_shared<const Expression>(r);
+  }
 };
 
-struct Number : TwoPartExpression {
-  int value;
-
-  Number(int v) : TwoPartExpression(ExpressionType::NUMBER, Expression(), Expression()), value(v) {}
+struct Number : Expression {
+  Number(int v) : Expression(ExpressionType::NUMBER) { value = v; }
 };
 
 struct Status : Expression {
   // with unknown number of Vars
-  std::vector<Var *> vars;
-  int dim = 0;
-
-  int constant = 0;
+  Status(Var *v1) : Expression(ExpressionType::STATUS) { vars = {v1}; }
+  Status(Var *v1, Var *v2) : Expression(ExpressionType::STATUS) { vars = {v1, v2}; }
 
-  Status(Var *v1) : Expression(ExpressionType::STATUS), vars({v1}), dim(1) {}
-  Status(Var *v1, Var *v2) : Expression(ExpressionType::STATUS), vars({v1, v2}), dim(2) {}
+  int dim() const { return static_cast<int>(vars.size()); }
 
   Status operator+(int c) const {
     Status res = *this;
@@ -227,11 +252,35 @@ struct Status : Expression {
   }
 };
 
+// The element of the k-th sequence of the problem at index v
+struct Element : Expression {
+  Element(int k, Var *v) : Expression(ExpressionType::ELEMENT) {
+    value = k;
+    vars = {v};
+  }
+};
+
+// The cost given with ProblemBuilder::withCost, evaluated at (a, b); for GLWS, Cost(J, I) is the cost of [j + 1, i]
+struct Cost : Expression {
+  Cost(Var *a, Var *b) : Expression(ExpressionType::COST) { vars = {a, b}; }
+};
+
 TwoPartExpression max(Expression s1, Expression s2) {
   TwoPartExpression res(ExpressionType::MAX, s1, s2);
   return res;
 }
 
+inline TwoPartExpression min(Expression s1, Expression s2) { return TwoPartExpression(ExpressionType::MIN, s1, s2); }
+
+inline TwoPartExpression operator+(const Expression &a, const Expression &b) {
+  return TwoPartExpression(ExpressionType::SUM, a, b);
+}
+
+inline Expression operator+(Expression e, int c) {
+  e.constant += c;
+  return e;
+}
+
 class SolverDispatcher;
 
 // Data input representation
@@ -265,6 +314,13 @@ class DPProblem {
 
   void setObjective(Objective obj) { objective = obj; }
 
+  void setAnswer(std::vector<int> state) { answer_state = std::move(state); }
+
+  void setCost(std::function<U(int, int)> cost, bool convex) {
+    cost_func = std::move(cost);
+    convex_cost = convex;
+  }
+
   void setRecurrence(std::function<void(const std::map<std::string, int> &)> recurrence_func) {
     this->recurrence_func = recurrence_func;
   }
@@ -306,7 +362,9 @@ class DPProblem {
     // std::cout << "conditions[0].first.name(): " << conditions[0].first.name() << std::endl;
     // std::cout << "conditions[0].second.name(): " << conditions[0].second.name() << std::endl;
     // LIS recognition pattern
-    if (state_variables.size() == 1 && state_variables[0]->type == Var::VarType::IND &&
+    if (weightSequence() >= 0) {
+      return ProblemType::WEIGHTED_LIS;
+    } else if (state_variables.size() == 1 && state_variables[0]->type == Var::VarType::IND &&
         range_dep_variables.size() == 1 && range_dep_variables[0]->range_type == RangeDepVar::RangeType::LIRV &&
         sequences.size() == 1 && conditions.size() == 1 && conditions[0].first.type == ConstraintType::NONE &&
         conditions[0].second.type == ExpressionType::MAX) {
@@ -315,6 +373,8 @@ class DPProblem {
                conditions.size() == 2 && conditions[0].first.type == ConstraintType::EQUAL &&
                conditions[0].second.type == ExpressionType::STATUS) {
       return ProblemType::LCS;
+    } else if (isGLWS()) {
+      return convex_cost || !cost_func ? ProblemType::CONVEX_GLWS : ProblemType::GLWS;
     }
 
     // Scale with more problem patterns here
@@ -329,11 +389,73 @@ class DPProblem {
         return solveLIS<U>();
       case ProblemType::LCS:
         return solveLCS<U>();
+      case ProblemType::WEIGHTED_LIS:
+        return solveWeightedLIS<U>();
+      case ProblemType::CONVEX_GLWS:
+      case ProblemType::GLWS:
+        return solveGLWS<U>(type);
       default:
-        throw std::runtime_error("Cannot solve problem: unknown type");
+        return solveWavefront();
     }
   }
 
+  /**
+   * @brief Solve the problem for many inputs at once
+   *
+   * instances[k] holds the sequences of instance k, in the order they were added. LIS and LCS instances are spread
+   * over the workers and solved sequentially, outliers aside (see Batch); any other problem solves the instances one
+   * after another with its own parallelism, each time with the instance's sequences swapped in.
+   *
+   * @return The answer of every instance
+   * @throws std::invalid_argument if an instance does not hold one sequence per sequence of the problem
+   */
+  std::vector<U> solve_batch(const std::vector<std::vector<std::vector<U>>> &instances) {
+    for (const auto &instance : instances) {
+      if (instance.size() != sequences.size()) {
+        throw std::invalid_argument("Batch instance has " + std::to_string(instance.size()) + " sequences, expected " +
+                                    std::to_string(sequences.size()));
+      }
+    }
+
+    std::vector<U> answers(instances.size());
+    switch (getProblemType()) {
+      case ProblemType::LIS:
+        Batch::run<LIS<U>>(
+            instances.size(), [&](size_t k) { return instances[k][0].size(); },
+            [&](LIS<U> &solver, size_t k, bool parallel) {
+              answers[k] = solver.compute(instances[k][0], parallel, AUTO_GRANULARITY);
+            });
+        return answers;
+      case ProblemType::LCS:
+        Batch::run<LCS<U>>(
+            instances.size(), [&](size_t k) { return instances[k][0].size() + instances[k][1].size(); },
+            [&](LCS<U> &solver, size_t k, bool parallel) {
+              answers[k] = solver.compute_paralay(instances[k][0], instances[k][1], parallel, AUTO_GRANULARITY);
+            });
+        return answers;
+      default:
+        break;
+    }
+
+    // Swap every instance into the problem's sequences, and the original data back even if a solve throws
+    std::vector<std::vector<U>> original(sequences.size());
+    for (size_t s = 0; s < sequences.size(); ++s) original[s].swap(sequences[s]->data);
+    auto restore = [&]() {
+      for (size_t s = 0; s < sequences.size(); ++s) sequences[s]->data.swap(original[s]);
+    };
+    try {
+      for (size_t k = 0; k < instances.size(); ++k) {
+        for (size_t s = 0; s < sequences.size(); ++s) sequences[s]->data = instances[k][s];
+        answers[k] = solve();
+      }
+    } catch (...) {
+      restore();
+      throw;
+    }
+    restore();
+    return answers;
+  }
+
  private:
   template <typename T>
   T solveLIS() {
@@ -341,7 +463,7 @@ class DPProblem {
 
     // Create backend solver
     LIS<T> solver;
-    return solver.compute(sequence, true, 1000);
+    return solver.compute(sequence, true, AUTO_GRANULARITY);
   }
 
   template <typename T>
@@ -349,23 +471,380 @@ class DPProblem {
     const auto &seq1 = sequences[0]->data;
     const auto &seq2 = sequences[1]->data;
 
-    int n = seq1.size();
-    // std::cout << "n: " << n << std::endl;
+    ArrowsCSR<> arrows = build_arrows(seq1, seq2);
+
+    // Create backend solver
+    LCS<int> solver;
+    return solver.compute_arrows_paralay(arrows);
+  }
+
+  // D[i] = max(D[j] + w[i], D[i]) over j in [0, i - 1] with the values in one sequence and the weights w in the other;
+  // returns the index of w, or -1 if the problem is not a weighted LIS
+  int weightSequence() const {
+    if (state_variables.size() != 1 || range_dep_variables.size() != 1 || sequences.size() != 2 ||
+        conditions.size() != 1 || conditions[0].first.type != ConstraintType::NONE) {
+      return -1;
+    }
+    const RangeDepVar *j = range_dep_variables[0];
+    if (j->range_type != RangeDepVar::RangeType::LIRV || j->min_val != state_variables[0]->min_value) return -1;
+    auto *last = dynamic_cast<const SingleDepVar *>(j->max_var);
+    if (!last || last->base != state_variables[0] || last->offset != -1) return -1;
+
+    // The weight sequence read at I, or -1
+    auto weight = [&](const Expression &x) {
+      bool read = x.type == ExpressionType::ELEMENT && x.constant == 0 && x.vars[0] == state_variables[0];
+      return read && (x.value == 0 || x.value == 1) ? x.value : -1;
+    };
+    auto layer = [&](const Expression &e) {
+      if (e.type != ExpressionType::SUM || e.constant != 0) return -1;
+      auto status = [&](const Expression &x) {
+        return x.type == ExpressionType::STATUS && x.constant == 0 && x.vars.size() == 1 &&
+               x.vars[0] == range_dep_variables[0];
+      };
+      if (status(*e.left)) return weight(*e.right);
+      return status(*e.right) ? weight(*e.left) : -1;
+    };
+    const Expression &e = conditions[0].second;
+    if (e.type != ExpressionType::MAX || e.constant != 0) return -1;
+    if (isSelf(*e.left) && e.left->constant == 0) return layer(*e.right);
+    return isSelf(*e.right) && e.right->constant == 0 ? layer(*e.left) : -1;
+  }
+
+  template <typename T>
+  T solveWeightedLIS() {
+    int w = weightSequence();
+    LIS<T> solver;
+    return solver.compute_weighted(sequences[1 - w]->data, sequences[w]->data, true, AUTO_GRANULARITY);
+  }
+
+  // E[i] = min(E[j] + w(j, i), E[i]) over j in [0, i - 1], with w given by withCost or by a "buildCost" value
+  bool isGLWS() const {
+    if (state_variables.size() != 1 || range_dep_variables.size() != 1 || sequences.size() > 1 ||
+        conditions.size() != 1 || conditions[0].first.type != ConstraintType::NONE) {
+      return false;
+    }
+    const IndVar *i = state_variables[0];
+    const RangeDepVar *j = range_dep_variables[0];
+    if (i->min_value != 0 || j->range_type != RangeDepVar::RangeType::LIRV || j->min_val != 0) return false;
+    auto *last = dynamic_cast<const SingleDepVar *>(j->max_var);
+    if (!last || last->base != i || last->offset != -1) return false;
+    if (!cost_func && !hasSequence("buildCost")) return false;
+
+    auto is = [](const Expression &e, ExpressionType type, std::vector<Var *> vars) {
+      return e.type == type && e.vars == vars && e.constant == 0;
+    };
+    auto is_segment = [&](const Expression &e) {
+      if (e.type != ExpressionType::SUM || e.constant != 0) return false;
+      auto status = [&](const Expression &x) { return is(x, ExpressionType::STATUS, {range_dep_variables[0]}); };
+      auto cost = [&](const Expression &x) {
+        return is(x, ExpressionType::COST, {range_dep_variables[0], state_variables[0]});
+      };
+      return (status(*e.left) && cost(*e.right)) || (cost(*e.left) && status(*e.right));
+    };
+    const Expression &e = conditions[0].second;
+    if (e.type != ExpressionType::MIN || e.constant != 0) return false;
+    bool self_left = is(*e.left, ExpressionType::STATUS, {state_variables[0]});
+    bool self_right = is(*e.right, ExpressionType::STATUS, {state_variables[0]});
+    return (self_left && is_segment(*e.right)) || (is_segment(*e.left) && self_right);
+  }
+
+  template <typename T>
+  T solveGLWS(ProblemType type) {
+    int n = state_variables[0]->max_value;
+    std::vector<T> data = sequences.empty() ? std::vector<T>(n) : sequences[0]->data;
+    if (static_cast<int>(data.size()) != n) {
+      throw std::invalid_argument("The sequence does not match the range of the state variable");
+    }
+
+    if (!cost_func) {
+      ConvexGLWS<T, PostOfficeCost<T>> solver;
+      return solver.compute(data, PostOfficeCost<T>(getValue<T>("buildCost")));
+    }
+    if (type == ProblemType::GLWS) {
+      // ConvexGLWS relies on monotone decisions with either CordonSearch, so without convexity every state takes the
+      // minimum over all earlier states
+      std::vector<T> D(n + 1, T());
+      for (int i = 1; i <= n; ++i) {
+        T best = std::numeric_limits<T>::max();
+#pragma omp parallel for reduction(min : best) if (i >= PARALLEL_RANGE)
+        for (int j = 0; j < i; ++j) best = std::min(best, D[j] + cost_func(j, i));
+        D[i] = best;
+      }
+      return D[n];
+    }
+    using CostFunction = std::function<T(int, int, const std::vector<T> &)>;
+    ConvexGLWS<T, CostFunction> solver;
+    return solver.compute(data, [this](int j, int i, const std::vector<T> &) { return cost_func(j, i); });
+  }
+
+  using Binding = std::vector<std::pair<const Var *, int>>;
+
+  // Ranges at least this long are reduced in parallel when the state itself is evaluated sequentially
+  static constexpr int PARALLEL_RANGE = 1000;
+
+  /**
+   * @brief Generic fallback for the recurrences the recognizer does not specialize
+   *
+   * Dependencies are read from the offsets of the Status indices and the bounds of the range variables, and the states
+   * are evaluated level by level (or tile by tile) by a Wavefront. Conventions:
+   *   - every condition whose constraint holds contributes a candidate, and the objective picks among them;
+   *     range variables in a constraint are reduced over at the level of the condition
+   *   - Status outside the box of states, and sequence elements out of range, contribute no candidate
+   *     (a constraint reading one does not hold)
+   *   - a state without candidates takes the "boundary" value (0 unless given with withValue)
+   *   - the answer is the state given with withAnswer, by default the upper bounds of all state variables
+   */
+  U solveWavefront() {
+    size_t d = state_variables.size();
+    if (d == 0) throw std::runtime_error("Cannot solve problem: no state variables");
+    std::vector<int> lower(d), upper(d);
+    for (size_t k = 0; k < d; ++k) {
+      lower[k] = state_variables[k]->min_value;
+      upper[k] = state_variables[k]->max_value;
+    }
+    std::vector<Wavefront::Dependency> dependencies;
+    for (const auto &condition : conditions) collectDependencies(condition.second, dependencies);
+
+    Wavefront wavefront(lower, upper, dependencies);
+    U boundary = hasSequence("boundary") ? getValue<U>("boundary") : U();
+    if (wavefront.size() == 0) return boundary;
+
+    std::vector<U> values(wavefront.size());
+    wavefront.run([&](const std::vector<int> &point, size_t idx) {
+      Binding env;
+      for (size_t k = 0; k < d; ++k) env.emplace_back(state_variables[k], point[k]);
+      std::optional<U> best;
+      for (const auto &condition : conditions) {
+        best = pick(best, evaluate(condition.first, condition.second, env, wavefront, values), maximize());
+      }
+      values[idx] = best.value_or(boundary);
+    });
+    if (answer_state.empty()) return values.back();
+    if (!wavefront.contains(answer_state)) throw std::out_of_range("The answer state is outside the states");
+    return values[wavefront.index(answer_state)];
+  }
+
+  bool maximize() const { return objective == Objective::MAXIMIZE; }
+
+  static std::optional<U> pick(std::optional<U> a, std::optional<U> b, bool maximize) {
+    if (!a) return b;
+    if (!b) return a;
+    return maximize ? std::max(*a, *b) : std::min(*a, *b);
+  }
+
+  bool isSelf(const Expression &e) const {
+    if (e.type != ExpressionType::STATUS || e.vars.size() != state_variables.size()) return false;
+    for (size_t k = 0; k < e.vars.size(); ++k) {
+      if (e.vars[k] != state_variables[k]) return false;
+    }
+    return true;
+  }
+
+  // Range of v - x_k over the box of states, where x_k is the k-th state variable
+  std::pair<double, double> offsetRange(const Var *v, size_t k) const {
+    const IndVar *x = state_variables[k];
+    switch (v->type) {
+      case Var::VarType::IND: {
+        auto *other = static_cast<const IndVar *>(v);
+        if (other == x) return {0, 0};
+        return {other->min_value - x->max_value, other->max_value - x->min_value};
+      }
+      case Var::VarType::SINGLE_DEP: {
+        auto *dep = static_cast<const SingleDepVar *>(v);
+        auto range = offsetRange(dep->base, k);
+        return {range.first + dep->offset, range.second + dep->offset};
+      }
+      default: {
+        auto *range = static_cast<const RangeDepVar *>(v);
+        double lo = range->range_type == RangeDepVar::RangeType::LIRV ? range->min_val - x->max_value
+                                                                      : offsetRange(range->min_var, k).first;
+        double hi = range->range_type == RangeDepVar::RangeType::LVRI ? range->max_val - x->min_value
+                                                                      : offsetRange(range->max_var, k).second;
+        return {lo, hi};
+      }
+    }
+  }
+
+  void collectDependencies(const Expression &e, std::vector<Wavefront::Dependency> &dependencies) const {
+    if (e.left) collectDependencies(*e.left, dependencies);
+    if (e.right) collectDependencies(*e.right, dependencies);
+    if (e.type != ExpressionType::STATUS || isSelf(e)) return;
+    if (e.vars.size() != state_variables.size()) {
+      throw std::invalid_argument("Status must have one index per state variable");
+    }
+    Wavefront::Dependency dep{std::vector<double>(e.vars.size()), std::vector<double>(e.vars.size())};
+    for (size_t k = 0; k < e.vars.size(); ++k) std::tie(dep.lo[k], dep.hi[k]) = offsetRange(e.vars[k], k);
+    dependencies.push_back(dep);
+  }
+
+  static std::optional<int> lookup(const Var *v, const Binding &env) {
+    for (auto it = env.rbegin(); it != env.rend(); ++it) {
+      if (it->first == v) return it->second;
+    }
+    if (v->type == Var::VarType::SINGLE_DEP) {
+      auto *dep = static_cast<const SingleDepVar *>(v);
+      if (auto base = lookup(dep->base, env)) return *base + dep->offset;
+    }
+    return std::nullopt;
+  }
+
+  // Collect the range variables reached from v that env does not bind
+  static void freeRanges(const Var *v, const Binding &env, std::vector<const RangeDepVar *> &ranges) {
+    if (!v || lookup(v, env)) return;
+    if (v->type == Var::VarType::SINGLE_DEP) {
+      freeRanges(static_cast<const SingleDepVar *>(v)->base, env, ranges);
+    } else if (v->type == Var::VarType::RANGE_DEP && std::find(ranges.begin(), ranges.end(), v) == ranges.end()) {
+      ranges.push_back(static_cast<const RangeDepVar *>(v));
+    }
+  }
 
-    parlay::sequence<parlay::sequence<size_t>> arrows(n);
+  static void freeRanges(const Expression &e, const Binding &env, std::vector<const RangeDepVar *> &ranges) {
+    for (const Var *v : e.vars) freeRanges(v, env, ranges);
+    if (e.left) freeRanges(*e.left, env, ranges);
+    if (e.right) freeRanges(*e.right, env, ranges);
+  }
 
-    for (int i = 0; i < n; ++i) {
-      for (int j = 0; j < n; ++j) {
-        if (seq1[i] == seq2[j]) {
-          arrows[i].push_back(j);
+  static std::pair<int, int> bounds(const RangeDepVar *range, const Binding &env) {
+    std::optional<int> lo =
+        range->range_type == RangeDepVar::RangeType::LIRV ? range->min_val : lookup(range->min_var, env);
+    std::optional<int> hi =
+        range->range_type == RangeDepVar::RangeType::LVRI ? range->max_val : lookup(range->max_var, env);
+    if (!lo || !hi) throw std::runtime_error("Range bounds depend on an unbound variable");
+    return {*lo, *hi};
+  }
+
+  template <typename G>
+  static void forEachBinding(const std::vector<const RangeDepVar *> &ranges, size_t k, Binding &env, G &g) {
+    if (k == ranges.size()) {
+      g(env);
+      return;
+    }
+    auto [lo, hi] = bounds(ranges[k], env);
+    for (int v = lo; v <= hi; ++v) {
+      env.emplace_back(ranges[k], v);
+      forEachBinding(ranges, k + 1, env, g);
+      env.pop_back();
+    }
+  }
+
+  // Best of g(env) over every binding of the ranges
+  template <typename G>
+  static std::optional<U> reduce(const std::vector<const RangeDepVar *> &ranges, Binding &env, bool maximize, G &&g) {
+    if (ranges.empty()) return g(env);
+    std::optional<U> best;
+    auto [lo, hi] = bounds(ranges[0], env);
+    if (hi - lo + 1 >= PARALLEL_RANGE && !omp_in_parallel()) {
+#pragma omp parallel
+      {
+        Binding local = env;
+        std::optional<U> mine;
+        auto visit = [&](Binding &b) { mine = pick(mine, g(b), maximize); };
+#pragma omp for schedule(static)
+        for (int v = lo; v <= hi; ++v) {
+          local.emplace_back(ranges[0], v);
+          forEachBinding(ranges, 1, local, visit);
+          local.pop_back();
         }
+#pragma omp critical
+        best = pick(best, mine, maximize);
       }
+      return best;
     }
+    auto visit = [&](Binding &b) { best = pick(best, g(b), maximize); };
+    forEachBinding(ranges, 0, env, visit);
+    return best;
+  }
 
-    // Create backend solver
-    LCS<int> solver;
-    // return solver.compute(seq1, seq2);
-    return solver.compute_arrows_paralay(n, arrows);
+  std::optional<U> element(const Sequence<U> *seq, const Var *idx, const Binding &env) const {
+    std::optional<int> i = lookup(idx, env);
+    if (!i) throw std::runtime_error("Sequence index is not bound");
+    if (*i < 0 || *i >= static_cast<int>(seq->data.size())) return std::nullopt;
+    return seq->data[*i];
+  }
+
+  bool holds(const Constraint<U> &c, const Binding &env) const {
+    if (c.type == ConstraintType::NONE) return true;
+    std::optional<U> a = element(c.val1.seq, c.val1.idx, env);
+    std::optional<U> b = element(c.val2.seq, c.val2.idx, env);
+    if (!a || !b) return false;
+    switch (c.type) {
+      case ConstraintType::LESS_THAN:
+        return *a < *b;
+      case ConstraintType::GREATER_THAN:
+        return *a > *b;
+      case ConstraintType::EQUAL:
+        return *a == *b;
+      default:
+        return *a != *b;
+    }
+  }
+
+  std::optional<U> evaluate(const Constraint<U> &c, const Expression &e, Binding &env, const Wavefront &wavefront,
+                            const std::vector<U> &values) const {
+    std::vector<const RangeDepVar *> ranges;
+    if (c.type != ConstraintType::NONE) {
+      freeRanges(c.val1.idx, env, ranges);
+      freeRanges(c.val2.idx, env, ranges);
+    }
+    return reduce(ranges, env, maximize(), [&](Binding &b) -> std::optional<U> {
+      if (!holds(c, b)) return std::nullopt;
+      return evaluate(e, b, wavefront, values);
+    });
+  }
+
+  std::optional<U> evaluate(const Expression &e, Binding &env, const Wavefront &wavefront,
+                            const std::vector<U> &values) const {
+    std::optional<U> result;
+    switch (e.type) {
+      case ExpressionType::NUMBER:
+        result = static_cast<U>(e.value);
+        break;
+      case ExpressionType::STATUS: {
+        if (isSelf(e)) return std::nullopt;
+        std::vector<int> point(e.vars.size());
+        for (size_t k = 0; k < e.vars.size(); ++k) {
+          std::optional<int> x = lookup(e.vars[k], env);
+          if (!x) throw std::runtime_error("Status index is not bound");
+          point[k] = *x;
+        }
+        if (!wavefront.contains(point)) return std::nullopt;
+        result = values[wavefront.index(point)];
+        break;
+      }
+      case ExpressionType::ELEMENT:
+        if (e.value < 0 || e.value >= static_cast<int>(sequences.size())) {
+          throw std::invalid_argument("Element reads a sequence the problem does not have");
+        }
+        result = element(sequences[e.value], e.vars[0], env);
+        break;
+      case ExpressionType::COST: {
+        if (!cost_func) throw std::runtime_error("Cost is used without withCost");
+        std::optional<int> a = lookup(e.vars[0], env), b = lookup(e.vars[1], env);
+        if (!a || !b) throw std::runtime_error("Cost argument is not bound");
+        result = cost_func(*a, *b);
+        break;
+      }
+      case ExpressionType::SUM: {
+        std::optional<U> a = evaluate(*e.left, env, wavefront, values);
+        std::optional<U> b = evaluate(*e.right, env, wavefront, values);
+        if (a && b) result = *a + *b;
+        break;
+      }
+      case ExpressionType::MAX:
+      case ExpressionType::MIN: {
+        bool best_max = e.type == ExpressionType::MAX;
+        std::vector<const RangeDepVar *> ranges;
+        freeRanges(e, env, ranges);
+        result = reduce(ranges, env, best_max, [&](Binding &b) {
+          return pick(evaluate(*e.left, b, wavefront, values), evaluate(*e.right, b, wavefront, values), best_max);
+        });
+        break;
+      }
+      default:
+        throw std::invalid_argument("Cannot evaluate an empty expression");
+    }
+    if (!result) return std::nullopt;
+    return *result + e.constant;
   }
 
  protected:
@@ -378,6 +857,9 @@ class DPProblem {
   std::vector<std::pair<Constraint<U>, Expression>> conditions;
   Objective objective = Objective::MAXIMIZE;
   std::function<void(const std::map<std::string, int> &)> recurrence_func;
+  std::function<U(int, int)> cost_func;  // See Cost
+  bool convex_cost = false;              // Whether cost_func satisfies the quadrangle inequality
+  std::vector<int> answer_state;         // The state solveWavefront returns, empty for the last one
   using DataType =
       std::variant<std::vector<int>, std::vector<long double>, std::vector<std::string>, long double, int, std::string>;
   std::map<std::string, DataType> data_map;
@@ -388,74 +870,12 @@ class SolverDispatcher {
  public:
   template <typename T>
   static T solve(DPProblem<T> &problem) {
-    ProblemType type = problem.getProblemType();
-
-    switch (type) {
-      case ProblemType::LIS:
-        return solveLIS<T>(problem);
-      case ProblemType::LCS:
-        return solveLCS<T>(problem);
-      case ProblemType::CONVEX_GLWS:
-        return solveConvexGLWS<T>(problem);
-      default:
-        throw std::runtime_error("Cannot solve problem: unknown type");
-    }
-  }
-
- private:
-  template <typename T>
-  static T solveLIS(DPProblem<T> &problem) {
-    const auto &sequence = problem.template getSequence<T>("sequence");
-
-    // Create backend solver
-    LIS<T> solver;
-    return solver.compute(sequence);
-  }
-
-  template <typename T>
-  static T solveLCS(DPProblem<T> &problem) {
-    const auto &seq1 = problem.template getSequence<T>(0);
-    const auto &seq2 = problem.template getSequence<T>(1);
-
-    int n = seq1.size();
-    // std::cout << "n: " << n << std::endl;
-
-    parlay::sequence<parlay::sequence<size_t>> arrows(n);
-
-    for (int i = 0; i < n; ++i) {
-      for (int j = 0; j < n; ++j) {
-        if (seq1[i] == seq2[j]) {
-          arrows[i].push_back(j);
-        }
-      }
-    }
-
-    // Create backend solver
-    LCS<int> solver;
-    // return solver.compute(seq1, seq2);
-    return solver.compute_arrows_paralay(n, arrows);
+    return problem.solve();
   }
 
   template <typename T>
-  static T solveConvexGLWS(DPProblem<T> &problem) {
-    const auto &sequence = problem.template getSequence<T>("data");
-    const auto &buildCost = problem.template getValue<T>("buildCost");
-
-    auto costFunc = [&](int j, int i, const std::vector<T> &pos) -> T {  // [j+1, i]
-      if (i - j < 1) return buildCost;
-      int len = i - j;
-      int mid_idx = j + 1 + (len - 1) / 2;
-      T median = pos[mid_idx];
-      T cost = 0;
-      for (int k = j + 1; k <= i; ++k) {
-        cost += std::abs(pos[k] - median);
-      }
-      return cost + buildCost;
-    };
-
-    // Create backend solver
-    ConvexGLWS<T> solver;
-    return solver.compute(sequence, costFunc, std::less<T>());
+  static std::vector<T> solve_batch(DPProblem<T> &problem, const std::vector<std::vector<std::vector<T>>> &instances) {
+    return problem.solve_batch(instances);
   }
 };
 
@@ -485,6 +905,22 @@ class ProblemBuilder {
     return *this;
   }
 
+  /**
+   * @brief Set the function read by Cost; a convex cost lets GLWS problems use the binary search of ConvexGLWS
+   */
+  ProblemBuilder &withCost(std::function<T(int, int)> cost, bool convex = false) {
+    problem_.setCost(std::move(cost), convex);
+    return *this;
+  }
+
+  /**
+   * @brief Set the state whose value the generic solver returns (e.g. {0, n - 1} for interval DP)
+   */
+  ProblemBuilder &withAnswer(std::vector<int> state) {
+    problem_.setAnswer(std::move(state));
+    return *this;
+  }
+
   ProblemBuilder &withObjective(Objective obj) {
     problem_.setObjective(obj);
     return *this;
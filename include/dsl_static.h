@@ -0,0 +1,234 @@
+#pragma once
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#include "dsl.h"
+
+namespace dp_dsl {
+
+/**
+ * @brief Compile-time form of the DSL.
+ *
+ * A recurrence is spelled as a type instead of a tree of runtime nodes, so it is recognized by template matching and
+ * Program<Recurrence> instantiates the specialized kernel directly, with the comparator and the cost inlined and no
+ * dispatch left at run time. A recurrence that matches no kernel fails to compile.
+ *
+ *   using namespace dp_dsl::ct;
+ *   using K = Range<0, Dec<I, 1>>;  // k ranges over [0, i - 1]
+ *   using LISRecurrence = max_<Status<I>, If<Lt<Seq<0, K>, Seq<0, I>>, Plus<Status<K>, Const<1>>>>;
+ *   int length = Program<LISRecurrence>()(data);
+ *
+ * Recognized recurrences, with either operand order of max_ and Plus:
+ *   LIS  max_<Status<I>, If<Lt<Seq<0, K>, Seq<0, I>>, Plus<Status<K>, Const<1>>>>  (or Gt for decreasing, or the
+ *        comparison written the other way around)
+ *   LCS  Select<Eq<Seq<0, Dec<I, 1>>, Seq<1, Dec<J, 1>>>, Plus<Status<Dec<I, 1>, Dec<J, 1>>, Const<1>>,
+ *               max_<Status<I, Dec<J, 1>>, Status<Dec<I, 1>, J>>>
+ *   GLWS min_<Plus<Status<K>, Cost<F>>>, where F(j, i, pos) is the cost of the segment [j + 1, i]; F must be convex
+ *        (satisfy the quadrangle inequality), since the kernel is ConvexGLWS: a non-convex F compiles but gives wrong
+ *        answers, use the runtime DSL without withCost(f, true) for those
+ */
+namespace ct {
+
+// Independent index variables
+template <int Id>
+struct Var {};
+using I = Var<0>;
+using J = Var<1>;
+
+// V - D
+template <typename V, int D>
+struct Dec {};
+
+// A variable ranging over [Lo, Hi]
+template <int Lo, typename Hi>
+struct Range {};
+
+template <int C>
+struct Const {};
+
+// Element Index of the K-th input sequence
+template <int K, typename Index>
+struct Seq {};
+
+template <typename A, typename B>
+struct Lt {};
+
+template <typename A, typename B>
+struct Gt {};
+
+template <typename A, typename B>
+struct Eq {};
+
+// DP value of the state at the given indices
+template <typename... Index>
+struct Status {};
+
+template <typename A, typename B>
+struct Plus {};
+
+// Segment cost F(j, i, pos), see ConvexGLWS
+template <typename F>
+struct Cost {};
+
+// Best of the alternatives, where an alternative over a Range variable stands for all of its values
+template <typename... E>
+struct max_ {};
+
+template <typename... E>
+struct min_ {};
+
+// Alternative E, only where Cond holds
+template <typename Cond, typename E>
+struct If {};
+
+// Then where Cond holds, Else otherwise
+template <typename Cond, typename Then, typename Else>
+struct Select {};
+
+template <typename P, typename A, typename B>
+constexpr bool is_sum_v = std::is_same_v<P, Plus<A, B>> || std::is_same_v<P, Plus<B, A>>;
+
+template <typename M, typename A, typename B>
+constexpr bool is_max_v = std::is_same_v<M, max_<A, B>> || std::is_same_v<M, max_<B, A>>;
+
+// The range of every earlier state of a 1D recurrence
+using Earlier = Range<0, Dec<I, 1>>;
+
+enum class Order { NONE, INCREASING, DECREASING };
+
+/**
+ * @brief Matches the relaxation of an LIS recurrence: Status<K> + 1 where Seq[k] and Seq[i] are ordered
+ */
+template <typename E>
+struct LISRelaxation {
+  static constexpr Order order = Order::NONE;
+};
+
+template <typename P>
+struct LISRelaxation<If<Lt<Seq<0, Earlier>, Seq<0, I>>, P>> {
+  static constexpr Order order = is_sum_v<P, Status<Earlier>, Const<1>> ? Order::INCREASING : Order::NONE;
+};
+
+template <typename P>
+struct LISRelaxation<If<Gt<Seq<0, I>, Seq<0, Earlier>>, P>> : LISRelaxation<If<Lt<Seq<0, Earlier>, Seq<0, I>>, P>> {};
+
+template <typename P>
+struct LISRelaxation<If<Gt<Seq<0, Earlier>, Seq<0, I>>, P>> {
+  static constexpr Order order = is_sum_v<P, Status<Earlier>, Const<1>> ? Order::DECREASING : Order::NONE;
+};
+
+template <typename P>
+struct LISRelaxation<If<Lt<Seq<0, I>, Seq<0, Earlier>>, P>> : LISRelaxation<If<Gt<Seq<0, Earlier>, Seq<0, I>>, P>> {};
+
+/**
+ * @brief Matches the segment term of a GLWS recurrence: Status<K> + Cost<F>
+ */
+template <typename P>
+struct GLWSTerm : std::false_type {};
+
+template <typename F>
+struct GLWSTerm<Plus<Status<Earlier>, Cost<F>>> : std::true_type {
+  using cost = F;
+};
+
+template <typename F>
+struct GLWSTerm<Plus<Cost<F>, Status<Earlier>>> : GLWSTerm<Plus<Status<Earlier>, Cost<F>>> {};
+
+/**
+ * @brief Recognize a recurrence; every recognized form provides its kernel as run(parallel, granularity, inputs...)
+ */
+template <typename Recurrence>
+struct Recognize {
+  static constexpr ProblemType type = ProblemType::UNKNOWN;
+};
+
+template <typename A, typename B>
+struct Recognize<max_<A, B>> {
+ private:
+  static constexpr Order order = std::is_same_v<A, Status<I>>   ? LISRelaxation<B>::order
+                                 : std::is_same_v<B, Status<I>> ? LISRelaxation<A>::order
+                                                                : Order::NONE;
+
+ public:
+  static constexpr ProblemType type = order == Order::NONE ? ProblemType::UNKNOWN : ProblemType::LIS;
+
+  template <typename T>
+  static int run(bool parallel, int granularity, const std::vector<T> &sequence) {
+    LIS<T> solver;
+    if constexpr (order == Order::INCREASING) {
+      return solver.compute(sequence, parallel, granularity);
+    } else {
+      // A strictly decreasing subsequence read backwards is strictly increasing
+      return solver.compute(std::vector<T>(sequence.rbegin(), sequence.rend()), parallel, granularity);
+    }
+  }
+};
+
+template <typename P, typename M>
+struct Recognize<Select<Eq<Seq<0, Dec<I, 1>>, Seq<1, Dec<J, 1>>>, P, M>> {
+  static constexpr ProblemType type = is_sum_v<P, Status<Dec<I, 1>, Dec<J, 1>>, Const<1>> &&
+                                              is_max_v<M, Status<I, Dec<J, 1>>, Status<Dec<I, 1>, J>>
+                                          ? ProblemType::LCS
+                                          : ProblemType::UNKNOWN;
+
+  template <typename T>
+  static int run(bool parallel, int granularity, const std::vector<T> &seq1, const std::vector<T> &seq2) {
+    if (seq1.empty() || seq2.empty()) return 0;
+    ArrowsCSR<> arrows = build_arrows(seq1, seq2);
+    LCS<T> solver;
+    return solver.compute_arrows_paralay(arrows, parallel, granularity);
+  }
+};
+
+template <typename P>
+struct Recognize<min_<P>> {
+  static constexpr ProblemType type = GLWSTerm<P>::value ? ProblemType::CONVEX_GLWS : ProblemType::UNKNOWN;
+
+  template <typename T, typename F>
+  static T run(bool parallel, int granularity, const std::vector<T> &data, F cost) {
+    static_assert(std::is_same_v<F, typename GLWSTerm<P>::cost>, "The cost must have the type named in Cost<F>");
+    ConvexGLWS<T, F> solver(CordonSearch::BINARY_SEARCH, granularity,
+                            parallel ? ParallelArch::OPENMP : ParallelArch::NONE);
+    return solver.compute(data, cost);
+  }
+};
+
+template <typename Recurrence>
+constexpr ProblemType problem_type_v = Recognize<Recurrence>::type;
+
+/**
+ * @brief A recurrence compiled to its specialized kernel
+ *
+ * @tparam Recurrence The recurrence, see the terms above
+ */
+template <typename Recurrence>
+class Program {
+ public:
+  static constexpr ProblemType type = problem_type_v<Recurrence>;
+  static_assert(type != ProblemType::UNKNOWN, "The recurrence does not match any specialized kernel");
+
+  /**
+   * @param parallel Whether the kernel runs in parallel
+   * @param granularity The minimum size of a subproblem to process in parallel, or AUTO_GRANULARITY
+   */
+  explicit Program(bool parallel = true, int granularity = AUTO_GRANULARITY)
+      : parallel(parallel), granularity(granularity) {}
+
+  /**
+   * @brief Solve for the given inputs: the sequence for LIS, both sequences for LCS, the data and the cost for GLWS
+   */
+  template <typename... Inputs>
+  auto operator()(const Inputs &...inputs) const {
+    return Recognize<Recurrence>::run(parallel, granularity, inputs...);
+  }
+
+ private:
+  bool parallel;
+  int granularity;
+};
+
+}  // namespace ct
+
+}  // namespace dp_dsl
\ No newline at end of file
@@ -1,125 +1,461 @@
 #pragma once
 
 #include <omp.h>
+#include <algorithm>
+#include <atomic>
 #include <functional>
 #include <limits>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
+#include "decision_list.h"
+#include "gpu.h"
+#include "granularity.h"
+#include "stats.h"
 #include "utils.h"
 
-template <typename T, typename Compare = std::less<T>>
+/**
+ * @brief Inclusive prefix sum computed in parallel with OpenMP
+ *
+ * Each thread scans its own block, the block totals are scanned sequentially, and each thread then adds its offset.
+ *
+ * @param in The input values
+ * @param out Output; out[k] = in[0] + ... + in[k]
+ */
+template <typename T>
+void parallelPrefixSum(const std::vector<T> &in, std::vector<T> &out) {
+  size_t n = in.size();
+  out.resize(n);
+  if (n == 0) return;
+  int maxBlocks = std::max(1, std::min(omp_get_max_threads(), static_cast<int>(n / 4096)));
+  std::vector<T> blockSum;
+#pragma omp parallel num_threads(maxBlocks)
+  {
+    int blocks = omp_get_num_threads();
+    int b = omp_get_thread_num();
+#pragma omp single
+    blockSum.assign(blocks + 1, T());
+    size_t lo = n * b / blocks, hi = n * (b + 1) / blocks;
+    T acc = T();
+    for (size_t k = lo; k < hi; ++k) {
+      acc += in[k];
+      out[k] = acc;
+    }
+    blockSum[b + 1] = acc;
+#pragma omp barrier
+#pragma omp single
+    for (int t = 1; t <= blocks; ++t) blockSum[t] += blockSum[t - 1];
+    for (size_t k = lo; k < hi; ++k) out[k] += blockSum[b];
+  }
+}
+
+/**
+ * @brief Detects GLWS cost models: callables that also expose prepare(pos) to precompute auxiliary arrays.
+ *
+ * A cost model is prepared once per solve with the 1-indexed positions (pos[0] is a sentinel) and must then answer
+ * cost(j, i, pos), the cost of covering states [j + 1, i] with one segment, in O(1).
+ */
+template <typename Cost, typename T, typename = void>
+struct is_glws_cost_model : std::false_type {};
+
+template <typename Cost, typename T>
+struct is_glws_cost_model<
+    Cost, T, std::void_t<decltype(std::declval<Cost &>().prepare(std::declval<const std::vector<T> &>()))>>
+    : std::true_type {};
+
+/**
+ * @brief Detects cost models that can be updated after positions were appended: extend(pos, from) must leave the model
+ * as prepare(pos) would, given that it was prepared on pos[0, from) before
+ */
+template <typename Cost, typename T, typename = void>
+struct is_glws_extendable : std::false_type {};
+
+template <typename Cost, typename T>
+struct is_glws_extendable<Cost, T,
+                          std::void_t<decltype(std::declval<Cost &>().extend(std::declval<const std::vector<T> &>(),
+                                                                             std::declval<size_t>()))>>
+    : std::true_type {};
+
+/**
+ * @brief Post office (1D facility placement) cost: every segment is served by one facility at its median.
+ *
+ * cost(j, i) = buildCost + sum_{k = j+1..i} |pos[k] - median|. Positions must be sorted; with prefix sums P the sum
+ * splits at the median into median * (mid - j) - (P[mid] - P[j]) + (P[i] - P[mid]) - median * (i - mid).
+ */
+template <typename T>
+class PostOfficeCost {
+ private:
+  T buildCost;
+  std::vector<T> prefix;  // prefix[k] = pos[0] + ... + pos[k]
+
+ public:
+  explicit PostOfficeCost(T buildCost) : buildCost(buildCost) {}
+
+  T build_cost() const { return buildCost; }
+
+  // The prefix sums of the positions of the last prepare() or extend()
+  const std::vector<T> &prefix_sums() const { return prefix; }
+
+  void prepare(const std::vector<T> &pos) { parallelPrefixSum(pos, prefix); }
+
+  void extend(const std::vector<T> &pos, size_t from) {
+    prefix.resize(pos.size());
+    for (size_t k = from; k < pos.size(); ++k) prefix[k] = (k > 0 ? prefix[k - 1] : T()) + pos[k];
+  }
+
+  T operator()(int j, int i, const std::vector<T> &pos) const {  // [j+1, i]
+    if (i - j < 1) return buildCost;
+    int mid = j + 1 + (i - j - 1) / 2;
+    T median = pos[mid];
+    T left = median * (mid - j) - (prefix[mid] - prefix[j]);
+    T right = (prefix[i] - prefix[mid]) - median * (i - mid);
+    return left + right + buildCost;
+  }
+};
+
+// How findCordon locates, for a relaxed candidate j, the first state that j improves
+enum class CordonSearch {
+  LINEAR,         // Scan i = j + 1 .. n; drops the monotone improvement of BINARY_SEARCH, the cost must still be convex
+  BINARY_SEARCH,  // Binary search over i; relies on "j beats the current best at i" being monotone in i (convex cost)
+};
+
+// Type-erased cost signature accepted by ConvexGLWS when no functor type is given
+template <typename T>
+using GLWSCostFunction = std::function<T(int, int, const std::vector<T> &)>;
+
+/**
+ * @brief Cordon solver for convex GLWS: D[i] = min_{j < i} D[j] + cost(j, i).
+ *
+ * The cost is a template parameter so user functors inline into the candidate-minimization loops. The default,
+ * GLWSCostFunction, keeps the std::function convenience for arbitrary callables at the price of an indirect call.
+ *
+ * @tparam T The value type of the positions and DP values
+ * @tparam Cost Callable cost(j, i, pos) for the segment [j + 1, i]; may be a cost model (see is_glws_cost_model)
+ * @tparam Compare Comparison that decides which of two DP values is better
+ */
+template <typename T, typename Cost = GLWSCostFunction<T>, typename Compare = std::less<T>>
 class ConvexGLWS {
+ private:
+  CordonSearch search;
+  int granularity;
+  ParallelArch arch;
+  // Work below which findIntervals recurses without spawning tasks, resolved from granularity for every solve
+  int task_cutoff = 0;
+  // Best decision of every state, rewritten by findIntervals each round and reused across rounds
+  std::vector<int> decision;
+  // Positions, DP values and decision runs of the last solve, kept so that later solves reuse their storage
+  std::vector<T> pos;
+  std::vector<T> D;
+  DecisionList B;
+  // Cost model of the positions grown by append(), kept so that its precomputed arrays are extended in place
+  std::optional<Cost> model;
+
  public:
+  /**
+   * @param search How findCordon locates the first state a candidate improves
+   * @param granularity The cutoff of findIntervals, in states plus candidates; AUTO_GRANULARITY derives it from the
+   * number of states and workers
+   * @param arch ParallelArch::GPU runs the rounds of compute() and compute_segments() on the device (see
+   * Gpu::PostOfficeGLWS), which needs PostOfficeCost and the binary search; append() always runs on the host.
+   * ParallelArch::NONE runs the rounds sequentially, any other value with OpenMP.
+   */
+  explicit ConvexGLWS(CordonSearch search = CordonSearch::BINARY_SEARCH, int granularity = AUTO_GRANULARITY,
+                      ParallelArch arch = ParallelArch::OPENMP)
+      : search(search), granularity(granularity), arch(arch) {}
+
   // Assume E[i] = D[i]
-  T compute(const std::vector<T> &data, std::function<T(int, int, const std::vector<T> &)> costFunc,
-            Compare cmp = Compare()) {
-    std::vector<T> pos;
-    pos.reserve(data.size() + 1);
-    pos.push_back(0);
+  T compute(const std::vector<T> &data, Cost costFunc, Compare cmp = Compare()) {
+    model.reset();
+    load_positions(data);
+    if constexpr (is_glws_cost_model<Cost, T>::value) costFunc.prepare(pos);
+    return solve(pos, costFunc, cmp);
+  }
+
+  /**
+   * @brief Solve with a cost model of another type, which is prepared once on the positions before the Cordon
+   * rounds start and then called through Cost (e.g. a std::function)
+   */
+  template <typename Model, typename = std::enable_if_t<is_glws_cost_model<Model, T>::value &&
+                                                        !std::is_same_v<std::decay_t<Model>, Cost>>>
+  T compute(const std::vector<T> &data, Model &external, Compare cmp = Compare()) {
+    model.reset();
+    load_positions(data);
+    external.prepare(pos);
+    Cost costFunc = [&external](int j, int i, const std::vector<T> &p) { return external(j, i, p); };
+    return solve(pos, costFunc, cmp);
+  }
+
+  /**
+   * @brief Compute the optimal segmentation instead of only its cost
+   *
+   * Every state records the decision it was finalized with (the B interval covering it in its Cordon round), and the
+   * segmentation is read back from state n along those decisions.
+   *
+   * @return The segment boundaries 0 = b_0 < b_1 < ... < b_k = n, where segment t covers the states [b_{t-1} + 1, b_t]
+   * and compute() equals the sum of cost(b_{t-1}, b_t)
+   */
+  std::vector<int> compute_segments(const std::vector<T> &data, Cost costFunc, Compare cmp = Compare()) {
+    model.reset();
+    load_positions(data);
+    if constexpr (is_glws_cost_model<Cost, T>::value) costFunc.prepare(pos);
+    std::vector<int> parent;
+    solve(pos, costFunc, cmp, &parent);
+
+    std::vector<int> boundaries;
+    for (int i = data.size(); i > 0; i = parent[i]) boundaries.push_back(i);
+    boundaries.push_back(0);
+    std::reverse(boundaries.begin(), boundaries.end());
+    return boundaries;
+  }
+
+  /**
+   * @brief Append positions to the ones solved by the last compute() or append() and return D of the last state
+   *
+   * States never depend on later ones, so the DP values of the earlier states stay final. The new states first get
+   * their best decision among the finalized states; decisions are monotone for a convex cost, so only the candidates
+   * from the decision of the last earlier state on are searched. The Cordon rounds then resume from the last earlier
+   * state and only visit new states and candidates, so an append costs O((m + d) log m) cost evaluations for m new
+   * positions and a last segment of length d, plus the rounds over the new states.
+   *
+   * A cost model is kept from the first append after compute() or clear() and updated with extend(pos, from) when it
+   * has one, otherwise prepared again on all positions; later cost arguments must describe the same cost.
+   */
+  T append(const std::vector<T> &data, Cost costFunc, Compare cmp = Compare()) {
+    if (D.empty()) {
+      load_positions({});
+      D.assign(1, 0);
+      B.clear();
+    }
+    size_t old = pos.size() - 1;
+    if (data.empty()) return D[old];
     pos.insert(pos.end(), data.begin(), data.end());
+    int n = pos.size() - 1;
+
+    if constexpr (is_glws_cost_model<Cost, T>::value) {
+      if (!model) {
+        model.emplace(std::move(costFunc));
+        model->prepare(pos);
+      } else if constexpr (is_glws_extendable<Cost, T>::value) {
+        model->extend(pos, old + 1);
+      } else {
+        model->prepare(pos);
+      }
+    } else {
+      model.reset();
+      model.emplace(std::move(costFunc));
+    }
+    const Cost &cost = *model;
+    task_cutoff = Granularity::resolve(granularity, n - old);
+
+    D.resize(n + 1, std::numeric_limits<T>::max());
+    decision.resize(n + 1);
+    assignDecisions(old == 0 ? 0 : B.find(old), old, old + 1, n, D, B, cost, cmp, pos);
+    run(old, n, cost, cmp, pos, nullptr);
+    return D[n];
+  }
+
+  /**
+   * @brief Forget the positions grown by append()
+   */
+  void clear() {
+    pos.clear();
+    D.clear();
+    B.clear();
+    model.reset();
+  }
+
+ private:
+  bool parallel() const { return arch != ParallelArch::NONE; }
 
-    int n = data.size();
-    if (n == 0) return T();
+  // Fill pos with a 1-indexed copy of the input and a sentinel at position 0
+  void load_positions(const std::vector<T> &data) {
+    pos.resize(data.size() + 1);
+    pos[0] = 0;
+    std::copy(data.begin(), data.end(), pos.begin() + 1);
+  }
 
-    std::vector<T> D(n + 1, std::numeric_limits<T>::max());
+  // When parent is given, it receives the decision every state was finalized with
+  T solve(const std::vector<T> &pos, const Cost &costFunc, Compare cmp, std::vector<int> *parent = nullptr) {
+    int n = pos.size() - 1;
+    if (parent) parent->assign(n + 1, 0);
+    D.assign(n + 1, std::numeric_limits<T>::max());
     D[0] = 0;
-    int now = 0;
+    if (n == 0) {
+      B.clear();
+      return T();
+    }
+    if (arch == ParallelArch::GPU) return solve_gpu(pos, costFunc, parent);
+    task_cutoff = Granularity::resolve(granularity, n);
 
-    std::vector<Interval> B;
-    B.push_back({1, n, 0});
+    B.reset(1, n, 0);
+    decision.assign(n + 1, 0);
+    run(0, n, costFunc, cmp, pos, parent);
+    return D[n];
+  }
 
+  // Cordon rounds finalizing the states (now, n], given that the states up to now are final and B holds the best
+  // decision among them for every later state
+  void run(int now, int n, const Cost &costFunc, Compare cmp, const std::vector<T> &pos, std::vector<int> *parent) {
+    Stats::Solve solve("glws", n - now);
+    Stats::Phase phase("rounds");
     while (now < n) {
       int cordon = findCordon(now, D, B, costFunc, cmp, pos);
-#pragma omp parallel for
+      Stats::frontier(cordon - 1 - now);
+#pragma omp parallel for if (parallel())
       for (int i = now + 1; i < cordon; ++i) {
-        int b = findBest(i, B);
+        int b = B.find(i);
         D[i] = D[b] + costFunc(b, i, pos);
+        if (parent) (*parent)[i] = b;
       }
       updateBest(now, cordon, n, D, B, costFunc, cmp, pos);
+      Stats::round();
       now = cordon - 1;
     }
+  }
 
-    return D[n];
+  // Run the rounds on the device, then read D and the decisions back so that append() can continue from them
+  T solve_gpu(const std::vector<T> &pos, const Cost &costFunc, std::vector<int> *parent) {
+    if constexpr (std::is_same_v<Cost, PostOfficeCost<T>> && Gpu::supported<T>) {
+      if (search != CordonSearch::BINARY_SEARCH) {
+        throw std::invalid_argument("ParallelArch::GPU needs CordonSearch::BINARY_SEARCH");
+      }
+      int n = pos.size() - 1;
+      Gpu::PostOfficeGLWS<T> device;
+      Stats::Solve solve("glws", n);
+      {
+        Stats::Phase phase("build");
+        device.reset(pos, costFunc.prefix_sums(), costFunc.build_cost());
+      }
+      {
+        Stats::Phase phase("rounds");
+        for (int now = 0; now < n;) {
+          int cordon = device.round(now);
+          Stats::frontier(cordon - 1 - now);
+          Stats::round();
+          now = cordon - 1;
+        }
+      }
+      device.download(D, decision);
+      B.reset(1, n, 0);
+      B.splice(1, n, decision);
+      if (parent) *parent = decision;
+      return D[n];
+    } else {
+      (void)pos;
+      (void)costFunc;
+      (void)parent;
+      throw std::invalid_argument("ParallelArch::GPU needs PostOfficeCost over int, long long or double");
+    }
   }
 
- private:
-  int findCordon(int now, std::vector<T> &D, const std::vector<Interval> &B,
-                 std::function<T(int, int, const std::vector<T> &)> costFunc, Compare cmp, const std::vector<T> &data) {
+  // Lower a shared minimum; the value only ever decreases, so a failed CAS just retries against the fresher value
+  static void writeMin(std::atomic<int> &target, int value) {
+    int current = target.load(std::memory_order_relaxed);
+    while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  /**
+   * @brief Binary search for the first state in [j + 1, hi] that candidate j improves
+   *
+   * For a convex cost, once j beats the current best decision (all of which are < j) at some state, it keeps beating
+   * it at every later state, so the predicate is monotone and O(log n) probes of the decision list suffice.
+   *
+   * @return The first improved state, or -1 if j improves none of [j + 1, hi]
+   */
+  int firstImproved(int j, T Dj, int hi, const std::vector<T> &D, const DecisionList &B, const Cost &costFunc,
+                    Compare cmp, const std::vector<T> &data) const {
+    auto improves = [&](int i) {
+      int current_best = B.find(i);
+      return cmp(Dj + costFunc(j, i, data), D[current_best] + costFunc(current_best, i, data));
+    };
+    int lo = j + 1;
+    if (lo > hi || !improves(hi)) return -1;
+    while (lo < hi) {
+      int mid = lo + (hi - lo) / 2;
+      if (improves(mid)) {
+        hi = mid;
+      } else {
+        lo = mid + 1;
+      }
+    }
+    return lo;
+  }
+
+  int findCordon(int now, const std::vector<T> &D, const DecisionList &B, const Cost &costFunc, Compare cmp,
+                 const std::vector<T> &data) {
     int n = data.size() - 1;
-    int cordon = n + 1;
+    // D, B and data are not modified while probing, so all threads read the same snapshot. The only per-thread
+    // result is s_j, which is folded into the shared cordon as soon as it is found. Since s_j > j, the current cordon
+    // also bounds the remaining work: candidates j >= cordon - 1 and states i >= cordon cannot lower it any more.
+    std::atomic<int> cordon(n + 1);
     for (int t = 1; (now + (1 << t)) <= n; ++t) {
       int l = now + (1 << (t - 1));
       int r = std::min(n, now + (1 << t) - 1);
-      std::vector<int> s_j(r - l + 1, n + 1);
       const int CACHE_LINE = 64 / sizeof(int);
-#pragma omp parallel for schedule(dynamic, CACHE_LINE) firstprivate(D, B, costFunc, cmp, data)
+#pragma omp parallel for schedule(dynamic, CACHE_LINE) if (parallel())
       for (int j = l; j <= r; ++j) {
-        int bestj = findBest(j, B);
+        if (j + 1 >= cordon.load(std::memory_order_relaxed)) continue;
+        int bestj = B.find(j);
         T Ej = D[bestj] + costFunc(bestj, j, data);
         T Dj = Ej;
-        if (cmp(Dj, D[j])) {
-          // Relax j
-          // Now find the earliest state i > j s.t. j can relax i better than its current best
-          for (int i = j + 1; i <= n; ++i) {
-            int current_best = findBest(i, B);
+        if (!cmp(Dj, D[j])) continue;
+        // Relax j
+        // Now find the earliest state i > j s.t. j can relax i better than its current best.
+        if (search == CordonSearch::BINARY_SEARCH) {
+          int found = firstImproved(j, Dj, std::min(n, cordon.load(std::memory_order_relaxed) - 1), D, B, costFunc,
+                                    cmp, data);
+          if (found > 0) writeMin(cordon, found);
+        } else {
+          // i only grows, so walk the decision list with a cursor instead of searching it for every i.
+          size_t cursor = B.lower_bound(j + 1);
+          for (int i = j + 1; i <= n && i < cordon.load(std::memory_order_relaxed); ++i) {
+            while (cursor < B.size() && B[cursor].r < i) ++cursor;
+            int current_best = (cursor < B.size() && B[cursor].l <= i) ? B[cursor].j : 0;
             T current_val = D[current_best] + costFunc(current_best, i, data);
             T candidate_val = Dj + costFunc(j, i, data);
             if (cmp(candidate_val, current_val)) {
-              s_j[j - l] = i;
+              writeMin(cordon, i);
               break;
             }
           }
-        } else {
-          s_j[j - l] = n + 1;
         }
       }
-      for (int x : s_j) cordon = std::min(cordon, x);
-      if (cordon <= r + 1) break;
+      if (cordon.load() <= r + 1) break;
     }
-    return cordon;
+    return cordon.load();
   }
 
-  void updateBest(int now, int cordon, int n, std::vector<T> &D, std::vector<Interval> &B,
-                  std::function<T(int, int, const std::vector<T> &)> costFunc, Compare cmp,
+  void updateBest(int now, int cordon, int n, std::vector<T> &D, DecisionList &B, const Cost &costFunc, Compare cmp,
                   const std::vector<T> &data) {
-    std::vector<Interval> B_new = findIntervals(now + 1, cordon - 1, cordon, n, D, costFunc, cmp, data);
-    std::vector<Interval> merged;
-    for (const auto &interval : B)
-      if (interval.r < cordon) merged.push_back(interval);
-    for (const auto &interval : B_new) merged.push_back(interval);
-
-    std::vector<Interval> compact;
-    if (!merged.empty()) {
-      compact.push_back(merged[0]);
-      for (size_t i = 1; i < merged.size(); i++) {
-        if (merged[i].j == compact.back().j && merged[i].l == compact.back().r + 1) {
-          compact.back().r = merged[i].r;
-        } else {
-          compact.push_back(merged[i]);
-        }
-      }
-    }
-    B = compact;
-  }
-
-  std::vector<Interval> findIntervals(int jl, int jr, int il, int ir, const std::vector<T> &D,
-                                      std::function<T(int, int, const std::vector<T> &)> costFunc, Compare cmp,
-                                      const std::vector<T> &data) {
-    std::vector<Interval> result;
-    if (il > ir) return result;
-    if (il == ir) {
-      int best = jl;
-      T val = D[best] + costFunc(best, il, data);
-      for (int j = jl + 1; j <= jr; ++j) {
-        T cand = D[j] + costFunc(j, il, data);
-        if (cmp(cand, val)) {
-          val = cand;
-          best = j;
-        }
-      }
-      result.push_back({il, ir, best});
-      return result;
+    if (cordon > n) return;
+    assignDecisions(now + 1, cordon - 1, cordon, n, D, B, costFunc, cmp, data);
+  }
+
+  // Set the decisions of the states [il, ir] to the best among the candidates [jl, jr]
+  void assignDecisions(int jl, int jr, int il, int ir, const std::vector<T> &D, DecisionList &B, const Cost &costFunc,
+                       Compare cmp, const std::vector<T> &data) {
+    // Only open a parallel region when the recursion is large enough to spawn tasks
+    if (parallel() && ir - jl > task_cutoff) {
+#pragma omp parallel
+#pragma omp single nowait
+      findIntervals(jl, jr, il, ir, D, costFunc, cmp, data);
+    } else {
+      findIntervals(jl, jr, il, ir, D, costFunc, cmp, data);
     }
+    // Keep the decisions of [0, il - 1] and compact the new ones into runs
+    B.splice(il, ir, decision);
+  }
+
+  /**
+   * @brief Compute the best decision of every state in [il, ir] among the candidates [jl, jr] and write it to
+   * decision[il..ir]; the two halves of the recursion cover disjoint states, so the tasks never write the same slot
+   */
+  void findIntervals(int jl, int jr, int il, int ir, const std::vector<T> &D, const Cost &costFunc, Compare cmp,
+                     const std::vector<T> &data) {
+    if (il > ir) return;
     int im = (il + ir) / 2;
     int best = jl;
     T val = D[best] + costFunc(best, im, data);
@@ -130,22 +466,20 @@ class ConvexGLWS {
         best = j;
       }
     }
+    decision[im] = best;
+    if (il == ir) return;
 
-    std::vector<Interval> L, R;
-    if (ir - il > 1000) {
-#pragma omp task shared(L)
-      { L = findIntervals(jl, best, il, im - 1, D, costFunc, cmp, data); }
-#pragma omp task shared(R)
-      { R = findIntervals(best, jr, im + 1, ir, D, costFunc, cmp, data); }
+    // The states and the candidates of a subproblem both grow its work
+    if (parallel() && (ir - il) + (jr - jl) > task_cutoff) {
+      // Reference parameters are firstprivate in a task by default, which would copy D, the cost and data each time
+#pragma omp task shared(D, costFunc, data)
+      findIntervals(jl, best, il, im - 1, D, costFunc, cmp, data);
+#pragma omp task shared(D, costFunc, data)
+      findIntervals(best, jr, im + 1, ir, D, costFunc, cmp, data);
 #pragma omp taskwait
     } else {
-      L = findIntervals(jl, best, il, im - 1, D, costFunc, cmp, data);
-      R = findIntervals(best, jr, im + 1, ir, D, costFunc, cmp, data);
+      findIntervals(jl, best, il, im - 1, D, costFunc, cmp, data);
+      findIntervals(best, jr, im + 1, ir, D, costFunc, cmp, data);
     }
-
-    result.insert(result.end(), L.begin(), L.end());
-    result.push_back({im, im, best});
-    result.insert(result.end(), R.begin(), R.end());
-    return result;
   }
 };
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Device-resident state of the Cordon rounds that ParallelArch::GPU offloads to CUDA.
+ *
+ * The kernels live in src/gpu and are only compiled with the PARALLELDP_GPU CMake option, which also defines
+ * PARALLELDP_GPU for every target. Without it this header is self-contained and every entry point throws
+ * std::runtime_error, so callers can select ParallelArch::GPU unconditionally and fall back on the error.
+ *
+ * Both solvers upload their input once per solve and keep it, the DP values and the per-leaf cursors on the device
+ * across rounds; the host only drives the round loop (which records Stats) and reads back one word per round, the
+ * termination flag. Buffers grow to the largest input and are reused by later solves.
+ */
+namespace Gpu {
+
+#ifdef PARALLELDP_GPU
+constexpr bool ENABLED = true;
+#else
+constexpr bool ENABLED = false;
+#endif
+
+// Value types PostOfficeGLWS is instantiated for
+template <typename T>
+constexpr bool supported = std::is_same_v<T, int> || std::is_same_v<T, long long> || std::is_same_v<T, double>;
+
+/**
+ * @brief Get the number of CUDA devices, 0 if there is none or GPU support was not built
+ */
+int device_count();
+
+/**
+ * @brief Leaves of the LCS prefix-min rounds: leaf i holds a cursor into row i of CSR arrows with sorted columns.
+ *
+ * A round computes, in one exclusive min-scan over the leaf heads, the minimum pre of the leaves before every leaf,
+ * and every leaf with a head of at most pre moves its cursor past the columns <= pre; a reduction of the new heads
+ * then gives the flag of the next round. This is the round of SegmentTree::prefix_min, flattened so that it does the
+ * same work for every leaf instead of pruning subtrees: the scan and the advance are bandwidth-bound passes, which is
+ * what the device is good at.
+ */
+class LCSRounds {
+ private:
+  struct Device;
+  std::unique_ptr<Device> device;
+
+ public:
+  LCSRounds();
+  ~LCSRounds();
+  LCSRounds(const LCSRounds &) = delete;
+  LCSRounds &operator=(const LCSRounds &) = delete;
+
+  /**
+   * @brief Upload n rows of arrows, row i holding columns[offsets[i], offsets[i + 1]) in ascending order
+   */
+  void reset(size_t n, const size_t *offsets, const uint32_t *columns);
+
+  /**
+   * @brief Whether any leaf has an arrow left, i.e. whether another round finds arrows; reads one word back
+   */
+  bool pending();
+
+  /**
+   * @brief Run one round on the device
+   */
+  void prefix_min();
+};
+
+/**
+ * @brief Cordon rounds of ConvexGLWS for PostOfficeCost, with the positions, their prefix sums, D and the best
+ * decision of every state on the device.
+ *
+ * round(now) runs the doubling stages of findCordon (one kernel per stage, candidates binary-searching the first state
+ * they improve and lowering the cordon with atomicMin), finalizes the states before the cordon, and reassigns the
+ * decisions of the later states among the new candidates with the divide and conquer of findIntervals, one kernel
+ * per recursion level and one warp per subproblem. A stage whose candidates all start behind the cordon exits without
+ * work, so no stage needs the cordon on the host; it is read back once, as the result of the round. The decisions of
+ * finalized states never change again, so at the end of a solve they are the segmentation.
+ *
+ * Instantiated for int, long long and double; device arithmetic is built without fused multiply-adds so that the
+ * values and the decisions match the host solver.
+ */
+template <typename T>
+class PostOfficeGLWS {
+ private:
+  struct Device;
+  std::unique_ptr<Device> device;
+  int n = 0;
+
+ public:
+  PostOfficeGLWS();
+  ~PostOfficeGLWS();
+  PostOfficeGLWS(const PostOfficeGLWS &) = delete;
+  PostOfficeGLWS &operator=(const PostOfficeGLWS &) = delete;
+
+  /**
+   * @brief Upload the 1-indexed positions (pos[0] is the sentinel) and their prefix sums, and reset D and B to the
+   * start of a solve
+   */
+  void reset(const std::vector<T> &pos, const std::vector<T> &prefix, T build_cost);
+
+  /**
+   * @brief Finalize the states after now up to the cordon of the round, given that the states up to now are final
+   *
+   * @return The cordon: the states (now, cordon) were finalized
+   */
+  int round(int now);
+
+  /**
+   * @brief Read back D and the decision every state was finalized with, n + 1 entries each
+   */
+  void download(std::vector<T> &D, std::vector<int> &decisions);
+};
+
+#ifndef PARALLELDP_GPU
+[[noreturn]] inline void unavailable() {
+  throw std::runtime_error("ParallelArch::GPU needs ParallelDP built with the PARALLELDP_GPU option");
+}
+
+inline int device_count() { return 0; }
+
+struct LCSRounds::Device {};
+inline LCSRounds::LCSRounds() = default;
+inline LCSRounds::~LCSRounds() = default;
+inline void LCSRounds::reset(size_t, const size_t *, const uint32_t *) { unavailable(); }
+inline bool LCSRounds::pending() { unavailable(); }
+inline void LCSRounds::prefix_min() { unavailable(); }
+
+template <typename T>
+struct PostOfficeGLWS<T>::Device {};
+template <typename T>
+PostOfficeGLWS<T>::PostOfficeGLWS() = default;
+template <typename T>
+PostOfficeGLWS<T>::~PostOfficeGLWS() = default;
+template <typename T>
+void PostOfficeGLWS<T>::reset(const std::vector<T> &, const std::vector<T> &, T) {
+  unavailable();
+}
+template <typename T>
+int PostOfficeGLWS<T>::round(int) {
+  unavailable();
+}
+template <typename T>
+void PostOfficeGLWS<T>::download(std::vector<T> &, std::vector<int> &) {
+  unavailable();
+}
+#else
+extern template class PostOfficeGLWS<int>;
+extern template class PostOfficeGLWS<long long>;
+extern template class PostOfficeGLWS<double>;
+#endif
+
+}  // namespace Gpu
\ No newline at end of file
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+/**
+ * @brief Granularity argument that asks a solver to choose its spawn cutoff itself, see Granularity
+ */
+constexpr int AUTO_GRANULARITY = -1;
+
+/**
+ * @brief Spawn cutoffs ("granularity") chosen from the machine and the input instead of hand-passed thresholds.
+ *
+ * A cutoff is expressed as a number of tasks per worker: subproblems smaller than n / (tasks * workers) run
+ * sequentially. Without measurements, heuristic() uses TASKS_PER_WORKER. With a sample of the input, tune() times
+ * the kernel for a few task counts and keeps the fastest.
+ *
+ * Tuned task counts are keyed by kernel, number of workers and size class (the power of two of n). They are kept for
+ * the process and appended to a cache file, so later runs skip the sampling. The file is .paralleldp_granularity in
+ * the working directory unless PARALLELDP_GRANULARITY_CACHE names another one; an empty value disables the file.
+ */
+class Granularity {
+ public:
+  static constexpr int TASKS_PER_WORKER = 8;
+  static constexpr int MIN = 64;  // Spawning a task costs more than a smaller subproblem saves
+  static constexpr int MAX = 1 << 20;
+
+  /**
+   * @brief The cutoff for n elements giving tasks tasks per worker; with a single worker nothing is split
+   */
+  static int heuristic(size_t n, int workers = omp_get_max_threads(), int tasks = TASKS_PER_WORKER) {
+    if (workers <= 1) return static_cast<int>(std::min<size_t>(n, INT_MAX));
+    size_t cutoff = n / (static_cast<size_t>(tasks) * workers);
+    return static_cast<int>(std::clamp<size_t>(cutoff, MIN, MAX));
+  }
+
+  /**
+   * @brief Resolve a granularity argument: AUTO_GRANULARITY becomes heuristic(n), other values are kept
+   */
+  static int resolve(int granularity, size_t n) {
+    return granularity == AUTO_GRANULARITY ? heuristic(n) : granularity;
+  }
+
+  /**
+   * @brief Tune the cutoff of a kernel for n elements, or reuse the value tuned earlier for the same setting
+   *
+   * @param kernel The name the result is cached under
+   * @param n The input size the cutoff is for
+   * @param sample_size The input size sample runs on
+   * @param sample sample(cutoff) runs the kernel on the sample with the given cutoff
+   * @return The cutoff for n
+   */
+  template <typename Sample>
+  static int tune(const std::string &kernel, size_t n, size_t sample_size, Sample &&sample) {
+    int workers = omp_get_max_threads();
+    if (workers <= 1 || n == 0) return heuristic(n, workers);
+    Key key{kernel, workers, size_class(n)};
+    {
+      std::lock_guard<std::mutex> lock(mutex());
+      auto it = cache().find(key);
+      if (it != cache().end()) return heuristic(n, workers, it->second);
+    }
+
+    int best = TASKS_PER_WORKER;
+    double best_time = std::numeric_limits<double>::max();
+    for (int tasks : {2, 4, 8, 16, 32}) {
+      int cutoff = heuristic(sample_size, workers, tasks);
+      // Best of two runs, so a cold cache on the first one does not decide
+      double time = std::numeric_limits<double>::max();
+      for (int run = 0; run < 2; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        sample(cutoff);
+        time = std::min(time, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+      }
+      if (time < best_time) {
+        best_time = time;
+        best = tasks;
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex());
+    cache()[key] = best;
+    std::string path = cache_path();
+    if (!path.empty()) {
+      std::ofstream file(path, std::ios::app);
+      file << kernel << ' ' << workers << ' ' << std::get<2>(key) << ' ' << best << '\n';
+    }
+    return heuristic(n, workers, best);
+  }
+
+  /**
+   * @brief Forget the tuned values of this process (the cache file is left untouched)
+   */
+  static void reset() {
+    std::lock_guard<std::mutex> lock(mutex());
+    cache().clear();
+  }
+
+ private:
+  using Key = std::tuple<std::string, int, int>;  // kernel, workers, size class
+
+  static int size_class(size_t n) {
+    int c = 0;
+    while (n >>= 1) ++c;
+    return c;
+  }
+
+  static std::string cache_path() {
+    const char *path = std::getenv("PARALLELDP_GRANULARITY_CACHE");
+    return path ? path : ".paralleldp_granularity";
+  }
+
+  static std::mutex &mutex() {
+    static std::mutex m;
+    return m;
+  }
+
+  // Loaded from the cache file on first use; later lines override earlier ones
+  static std::map<Key, int> &cache() {
+    static std::map<Key, int> tuned = [] {
+      std::map<Key, int> entries;
+      std::string path = cache_path();
+      if (path.empty()) return entries;
+      std::ifstream file(path);
+      std::string kernel;
+      int workers, c, tasks;
+      while (file >> kernel >> workers >> c >> tasks) {
+        if (tasks > 0) entries[Key{kernel, workers, c}] = tasks;
+      }
+      return entries;
+    }();
+    return tuned;
+  }
+};
\ No newline at end of file
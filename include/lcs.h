@@ -1,15 +1,27 @@
 #pragma once
 
-#include <chrono>
+#include <cstdint>
+#include <numeric>
+#include <optional>
+#include <type_traits>
 #include <unordered_map>
+#include "arrows.h"
+#include "batch.h"
+#include "gpu.h"
+#include "granularity.h"
+#include "lcs_bitparallel.h"
 #include "lis.h"
+#include "numa_placement.h"
 #include "segment_tree.h"
 #include "segment_tree_cilk.h"
+#include "stats.h"
 
 #include "parlay/internal/group_by.h"
 #include "parlay/parallel.h"
 #include "parlay/primitives.h"
 #include "segment_tree_cilk_opt.h"
+#include "tournament_tree.h"
+#include "tree_layout.h"
 #include "utils.h"
 
 template <typename Left, typename Right>
@@ -22,16 +34,175 @@ void conditional_par_do(bool parallel, Left left, Right right) {
   }
 }
 
-#define lc(x) ((x) << 1)
-#define rc(x) ((x) << 1 | 1)
+template <typename F>
+void conditional_parallel_for(bool parallel, size_t start, size_t end, F f, long granularity = 0) {
+  if (parallel) {
+    parlay::parallel_for(start, end, f, granularity);
+  } else {
+    for (size_t i = start; i < end; ++i) f(i);
+  }
+}
+
+// Symbol ranges up to this size are grouped with a counting sort instead of a comparison sort
+constexpr long long SMALL_ALPHABET = 256;
+
+/**
+ * @brief Group the positions of b by symbol for build_arrows using a blocked counting sort
+ *
+ * Only applies to integral inputs whose values in b span at most SMALL_ALPHABET symbols (DNA, bytes, small integer
+ * alphabets). Symbol s owns occ[start[s], start[s + 1]), with positions ascending; start has one trailing empty group
+ * for symbols of a that never occur in b. count is scratch space, kept by the caller so that it is reused.
+ *
+ * @return false if b does not fit the fast path, leaving the outputs untouched
+ */
+template <typename T>
+bool group_small_alphabet(const std::vector<T> &a, const std::vector<T> &b, parlay::sequence<uint32_t> &occ,
+                          std::vector<size_t> &start, std::vector<uint32_t> &group, std::vector<size_t> &count,
+                          bool parallel = true) {
+  if constexpr (!std::is_integral_v<T>) {
+    return false;
+  } else {
+    size_t n = a.size(), m = b.size();
+    if (m == 0) return false;
+    long long lo = std::numeric_limits<long long>::max(), hi = std::numeric_limits<long long>::min();
+#pragma omp parallel for reduction(min : lo) reduction(max : hi) if (parallel)
+    for (size_t j = 0; j < m; ++j) {
+      lo = std::min(lo, static_cast<long long>(b[j]));
+      hi = std::max(hi, static_cast<long long>(b[j]));
+    }
+    // In unsigned arithmetic, since the span of 64-bit values can exceed LLONG_MAX
+    if (static_cast<unsigned long long>(hi) - static_cast<unsigned long long>(lo) >= SMALL_ALPHABET) return false;
+
+    size_t symbols = hi - lo + 1;
+    size_t blocks = parallel ? std::max<size_t>(1, std::min<size_t>(parlay::num_workers() * 4, m / 4096)) : 1;
+    size_t block_size = (m + blocks - 1) / blocks;
+    auto symbol = [&](const T &x) { return static_cast<size_t>(static_cast<long long>(x) - lo); };
+
+    // count[s * blocks + k] is the number of occurrences of symbol s in block k; scanning it symbol-major yields
+    // where each block scatters its occurrences, which keeps the positions of a symbol in ascending order
+    count.assign(symbols * blocks, 0);
+    conditional_parallel_for(parallel, 0, blocks, [&](size_t k) {
+      size_t end = std::min(m, (k + 1) * block_size);
+      for (size_t j = k * block_size; j < end; ++j) count[symbol(b[j]) * blocks + k]++;
+    }, 1);
+    std::exclusive_scan(count.begin(), count.end(), count.begin(), size_t(0));
+
+    start.assign(symbols + 2, m);
+    for (size_t c = 0; c < symbols; ++c) start[c] = count[c * blocks];
+
+    occ.resize(m);
+    conditional_parallel_for(parallel, 0, blocks, [&](size_t k) {
+      size_t end = std::min(m, (k + 1) * block_size);
+      for (size_t j = k * block_size; j < end; ++j) occ[count[symbol(b[j]) * blocks + k]++] = j;
+    }, 1);
+
+    group.resize(n);
+    conditional_parallel_for(parallel, 0, n, [&](size_t i) {
+      long long x = static_cast<long long>(a[i]);
+      group[i] = (x >= lo && x <= hi) ? static_cast<uint32_t>(x - lo) : static_cast<uint32_t>(symbols);
+    });
+    return true;
+  }
+}
+
+/**
+ * @brief Group the positions of b by symbol for build_arrows using a stable sort, parallel if parallel; T only needs
+ * operator<
+ */
+template <typename T>
+void group_sorted(const std::vector<T> &a, const std::vector<T> &b, parlay::sequence<uint32_t> &occ,
+                  std::vector<size_t> &start, std::vector<uint32_t> &group, bool parallel = true) {
+  size_t n = a.size(), m = b.size();
+  auto before = [&](uint32_t x, uint32_t y) { return b[x] < b[y]; };
+  auto is_head = [&](size_t k) { return k == 0 || b[occ[k - 1]] < b[occ[k]]; };
+  parlay::sequence<size_t> heads;
+  if (parallel) {
+    occ = parlay::stable_sort(parlay::tabulate(m, [](size_t j) { return static_cast<uint32_t>(j); }), before);
+    heads = parlay::pack_index(parlay::delayed_seq<bool>(m, is_head));
+  } else {
+    occ.resize(m);
+    std::iota(occ.begin(), occ.end(), 0u);
+    std::stable_sort(occ.begin(), occ.end(), before);
+    for (size_t k = 0; k < m; ++k) {
+      if (is_head(k)) heads.push_back(k);
+    }
+  }
+
+  size_t groups = heads.size();
+  start.assign(groups + 2, m);
+  conditional_parallel_for(parallel, 0, groups, [&](size_t g) { start[g] = heads[g]; });
+
+  group.resize(n);
+  conditional_parallel_for(parallel, 0, n, [&](size_t i) {
+    size_t g = std::lower_bound(heads.begin(), heads.end(), a[i],
+                                [&](size_t head, const T &x) { return b[occ[head]] < x; }) -
+               heads.begin();
+    group[i] = (g < groups && !(a[i] < b[occ[heads[g]]])) ? static_cast<uint32_t>(g) : static_cast<uint32_t>(groups);
+  });
+}
+
+/**
+ * @brief Scratch arrays of build_arrows, kept by callers that build arrows repeatedly so that they are reused
+ */
+struct ArrowBuffers {
+  parlay::sequence<uint32_t> occ;  // Positions of b grouped by symbol
+  std::vector<size_t> start;       // Group g owns occ[start[g], start[g + 1])
+  std::vector<uint32_t> group;     // Group of every symbol of a
+  std::vector<size_t> count;       // Occurrences of every symbol in every block of the counting sort
+};
+
+/**
+ * @brief Build the LCS arrows of a against b in parallel: row i holds every j with a[i] == b[j], in ascending order
+ *
+ * The positions of b are grouped by symbol once (counting sort for small alphabets, stable sort otherwise) and every
+ * row is then a copy of its symbol's group, so the work is O(m log m + n + #arrows) instead of O(n * m). The arrows
+ * and the scratch arrays are rebuilt in place; only the stable sort of large alphabets allocates once they have grown
+ * to the largest input. Without parallel, neither an OpenMP region is opened nor a parlay task forked, so that a
+ * build_arrows in a batch never waits at a join, where its worker could pick up another batch task that reuses the
+ * same ArrowBuffers.
+ */
+template <typename T>
+void build_arrows(const std::vector<T> &a, const std::vector<T> &b, ArrowsCSR<> &arrows, ArrowBuffers &buffers,
+                  bool parallel = true) {
+  const auto &occ = buffers.occ;
+  const auto &start = buffers.start;
+  const auto &group = buffers.group;
+  if (!group_small_alphabet(a, b, buffers.occ, buffers.start, buffers.group, buffers.count, parallel)) {
+    group_sorted(a, b, buffers.occ, buffers.start, buffers.group, parallel);
+  }
+
+  arrows.assign(
+      a.size(), [&](size_t i) { return start[group[i] + 1] - start[group[i]]; },
+      [&](size_t i, uint32_t *out) {
+        std::copy(occ.begin() + start[group[i]], occ.begin() + start[group[i] + 1], out);
+      },
+      parallel);
+}
+
+template <typename T>
+ArrowsCSR<> build_arrows(const std::vector<T> &a, const std::vector<T> &b) {
+  ArrowsCSR<> arrows;
+  ArrowBuffers buffers;
+  build_arrows(a, b, arrows, buffers);
+  return arrows;
+}
 
 // Use the Cordon algorithm to solve the Longest Common Subsequence (LCS) problem,
-// supporting any data type T and user-defined comparison functions.
+// supporting any data type T and user-defined comparison functions. The trees, the arrows built by compute() and the
+// buffers of compute_arrows_paralay are kept between calls and rebuilt in place, so an LCS object that solves many
+// inputs only allocates when an input is larger than every earlier one.
 template <typename T, typename Compare = std::less<T>>
 class LCS {
  private:
   std::unique_ptr<Tree<int>> tree;
-  std::unique_ptr<SegmentTreeCilkOpt<size_t>> tree_opt;
+  std::unique_ptr<Tree<size_t>> tree_opt;
+  ArrowsCSR<> arrows;                    // Arrows of the last compute(), swapped with the rows of the tree
+  ArrowBuffers arrow_buffers;            // Scratch arrays of build_arrows
+  first_touch_vector<size_t> leaf_now;   // Consumed arrows of every leaf in paralay_rounds
+  first_touch_vector<size_t> leaf_tree;  // Tree array of paralay_rounds
+  BitParallelLCS<T> bit_parallel;        // Solver of ParallelArch::BIT_PARALLEL
+  LIS<uint32_t> weighted_lis;            // Solver of compute_weighted
+  Gpu::LCSRounds gpu;                    // Device state of ParallelArch::GPU
 
  public:
   /**
@@ -79,156 +250,425 @@ class LCS {
                           parallel, granularity);
   }
 
+  template <typename Layout = HeapLayout>
   int compute_arrows(std::vector<std::vector<int>> &arrows, ParallelArch arch = ParallelArch::CILK,
                      bool parallel = false, int granularity = 0) {
-    auto start = std::chrono::high_resolution_clock::now();
-    if (arch == ParallelArch::CILK) {
-      tree = std::make_unique<SegmentTreeCilk<int>>(arrows, std::numeric_limits<int>::max(), parallel, granularity);
-    } else if (arch == ParallelArch::OPENMP) {
-      tree = std::make_unique<SegmentTreeOpenMP<int>>(arrows, std::numeric_limits<int>::max(), parallel, granularity);
-    } else {
-      throw std::invalid_argument("Invalid parallel architecture");
+    return compute_arrows<Layout>(ArrowsCSR<>::from_nested(arrows), arch, parallel, granularity);
+  }
+
+  /**
+   * @brief Run the Cordon rounds on arrows stored in CSR form; the rows are moved into the tree without a copy
+   */
+  template <typename Layout = HeapLayout>
+  int compute_arrows(ArrowsCSR<> rows, ParallelArch arch = ParallelArch::CILK, bool parallel = false,
+                     int granularity = 0) {
+    Stats::Solve solve("lcs", rows.size());
+    return cordon_rounds<Layout>(rows, arch, parallel, granularity);
+  }
+
+  template <typename Layout = HeapLayout>
+  int compute_arrows_paralay(size_t n, const parlay::sequence<parlay::sequence<size_t>> &arrows,
+                             bool ifparallel = false, int granularity = 5000) {
+    Stats::Solve solve("lcs", n);
+    auto row = [&](size_t i) -> const parlay::sequence<size_t> & { return arrows[i]; };
+    return paralay_rounds<Layout>(n, row, ifparallel, paralay_granularity<Layout>(n, row, ifparallel, granularity));
+  }
+
+  /**
+   * @brief Same as above on CSR arrows, where leaf l (1-indexed) reads row l - 1
+   */
+  template <typename Layout = HeapLayout>
+  int compute_arrows_paralay(const ArrowsCSR<> &arrows, bool ifparallel = false, int granularity = 5000) {
+    Stats::Solve solve("lcs", arrows.size());
+    return paralay_csr<Layout>(arrows, ifparallel, granularity);
+  }
+
+  template <typename Layout = HeapLayout>
+  int compute_arrows_opt(const parlay::sequence<parlay::sequence<size_t>> &arrows, bool ifparallel = false,
+                         int granularity = 5000) {
+    return compute_arrows_opt<Layout>(ArrowsCSR<>::from_nested(arrows), ifparallel, granularity);
+  }
+
+  template <typename Layout = HeapLayout>
+  int compute_arrows_opt(ArrowsCSR<> rows, bool ifparallel = false, int granularity = 5000) {
+    Stats::Solve solve("lcs", rows.size());
+    {
+      Stats::Phase phase("build");
+      granularity = Granularity::resolve(granularity, rows.size());
+      rebuild<SegmentTreeCilkOpt<size_t, Layout>>(tree_opt, rows, ifparallel, granularity);
     }
-    auto end = std::chrono::high_resolution_clock::now();
-    // std::cout << ", Tree building time: " << std::chrono::duration_cast<std::chrono::milliseconds>(end -
-    // start).count();
 
+    Stats::Phase phase("rounds");
+    int round = 0;
+    while (tree_opt->global_min() < std::numeric_limits<int>::max()) {
+      round++;
+      tree_opt->prefix_min();
+      Stats::round();
+    }
+    return round;
+  }
+  /**
+   * @brief Compute the LCS length of two sequences, building their arrows first
+   *
+   * ParallelArch::BIT_PARALLEL skips the arrows and runs BitParallelLCS, whose n * m / 64 work does not depend on the
+   * matches; ParallelArch::AUTO takes it when the arrows are at least that many (see BitParallelLCS::preferred) and
+   * the PARLAY tree otherwise. ParallelArch::GPU runs the rounds on the device (see Gpu::LCSRounds) and throws
+   * std::runtime_error when ParallelDP was built without it.
+   */
+  int compute(const std::vector<T> &data1, const std::vector<T> &data2, ParallelArch arch = ParallelArch::CILK,
+              bool parallel = false, int granularity = 0) {
+    int n = data1.size(), m = data2.size();
+    if (n == 0 || m == 0) return 0;
+
+    if (arch == ParallelArch::AUTO) {
+      arch = BitParallelLCS<T>::preferred(data1, data2) ? ParallelArch::BIT_PARALLEL : ParallelArch::PARLAY;
+    }
+    if (arch == ParallelArch::BIT_PARALLEL) return bit_parallel.compute(data1, data2, parallel);
+
+    Stats::Solve solve("lcs", n);
+    {
+      // Get the effective states: (i, j) pairs where data1[i] == data2[j]
+      Stats::Phase phase("arrows");
+      build_arrows(data1, data2, arrows, arrow_buffers);
+    }
+    return cordon_rounds<HeapLayout>(arrows, arch, parallel, granularity);
+  }
+
+  int compute(const std::string &data1, const std::string &data2, ParallelArch arch = ParallelArch::CILK,
+              bool parallel = false, int granularity = 0) {
+    return compute(std::vector<T>(data1.begin(), data1.end()), std::vector<T>(data2.begin(), data2.end()), arch,
+                   parallel, granularity);
+  }
+
+  /**
+   * @brief Build the arrows into the buffers kept by this object and run the rounds of compute_arrows_paralay on them
+   */
+  int compute_paralay(const std::vector<T> &data1, const std::vector<T> &data2, bool parallel = false,
+                      int granularity = AUTO_GRANULARITY) {
+    if (data1.empty() || data2.empty()) return 0;
+    Stats::Solve solve("lcs", data1.size());
+    {
+      Stats::Phase phase("arrows");
+      build_arrows(data1, data2, arrows, arrow_buffers, parallel);
+    }
+    return paralay_csr<HeapLayout>(arrows, parallel, granularity);
+  }
+
+  /**
+   * @brief Compute the LCS of many independent pairs, first[k] against second[k], see Batch
+   *
+   * Every pair runs the rounds of compute_arrows_paralay, sequentially unless it is an outlier of the batch.
+   *
+   * @param granularity The cutoff used for outliers, or AUTO_GRANULARITY
+   * @return The LCS length of every pair
+   * @throws std::invalid_argument if first and second hold different numbers of sequences
+   */
+  static std::vector<int> compute_batch(const std::vector<std::vector<T>> &first,
+                                        const std::vector<std::vector<T>> &second, int granularity = AUTO_GRANULARITY) {
+    if (first.size() != second.size()) {
+      throw std::invalid_argument("Batch sequences differ in number");
+    }
+    std::vector<int> lengths(first.size(), 0);
+    Batch::run<LCS>(
+        first.size(), [&](size_t k) { return first[k].size() + second[k].size(); },
+        [&](LCS &solver, size_t k, bool parallel) {
+          lengths[k] = solver.compute_paralay(first[k], second[k], parallel, granularity);
+        });
+    return lengths;
+  }
+
+  /**
+   * @brief Compute one longest common subsequence as matched index pairs instead of only its length
+   *
+   * The Cordon rounds run as in compute(), with the tree recording in which round every arrow was consumed, i.e. the
+   * LCS length ending at that match. Grouping the arrows by round with a parallel stable sort keeps each round in
+   * row-major order, and within one round a later row never holds a larger column. The predecessor of a match (i, j)
+   * is therefore the first arrow of the last row before i in the previous round, found with two binary searches.
+   * The round buffer, the sort permutation and the copy of the arrows kept for the walk are only allocated here.
+   *
+   * @return Pairs (i, j) with data1[i] == data2[j], strictly increasing in both components
+   */
+  template <typename Layout = HeapLayout>
+  std::vector<std::pair<int, int>> compute_alignment(const std::vector<T> &data1, const std::vector<T> &data2,
+                                                     ParallelArch arch = ParallelArch::CILK, bool parallel = false,
+                                                     int granularity = 0) {
+    if (data1.empty() || data2.empty()) return {};
+
+    Stats::Solve solve("lcs_alignment", data1.size());
+    std::optional<Stats::Phase> phase(std::in_place, "arrows");
+    build_arrows(data1, data2, arrows, arrow_buffers);
+    std::vector<size_t> offsets(arrows.offsets_data(), arrows.offsets_data() + arrows.size() + 1);
+    std::vector<uint32_t> columns(arrows.columns_data(), arrows.columns_data() + arrows.nnz());
+    std::vector<int> consumed;
+    phase.emplace("build");
+    make_tree<Layout>(arrows, arch, parallel, granularity);
+    tree->track_rounds(&consumed);
+
+    phase.emplace("rounds");
+    int length = 0;
+    while (tree->global_min() < std::numeric_limits<int>::max()) {
+      length++;
+      tree->prefix_min();
+      Stats::round();
+    }
+    tree->track_rounds(nullptr);
+    if (length == 0) return {};
+
+    phase.emplace("walk");
+
+    size_t nnz = columns.size();
+    auto byRound = parlay::stable_sort(parlay::tabulate(nnz, [](size_t k) { return k; }),
+                                       [&](size_t x, size_t y) { return consumed[x] < consumed[y]; });
+    std::vector<size_t> first(length + 2, nnz);
+    parlay::parallel_for(0, nnz, [&](size_t k) {
+      if (k == 0 || consumed[byRound[k - 1]] != consumed[byRound[k]]) first[consumed[byRound[k]]] = k;
+    });
+    auto row = [&](size_t k) {
+      return static_cast<int>(std::upper_bound(offsets.begin(), offsets.end(), k) - offsets.begin() - 1);
+    };
+
+    std::vector<std::pair<int, int>> alignment(length);
+    size_t match = byRound[first[length]];
+    alignment[length - 1] = {row(match), static_cast<int>(columns[match])};
+    for (int r = length - 1; r >= 1; --r) {
+      auto begin = byRound.begin() + first[r], end = byRound.begin() + first[r + 1];
+      int i = alignment[r].first;
+      auto before = std::partition_point(begin, end, [&](size_t k) { return row(k) < i; });
+      int last_row = row(*(before - 1));
+      match = *std::partition_point(begin, before, [&](size_t k) { return row(k) < last_row; });
+      alignment[r - 1] = {last_row, static_cast<int>(columns[match])};
+    }
+    return alignment;
+  }
+
+  template <typename Layout = HeapLayout>
+  std::vector<std::pair<int, int>> compute_alignment(const std::string &data1, const std::string &data2,
+                                                     ParallelArch arch = ParallelArch::CILK, bool parallel = false,
+                                                     int granularity = 0) {
+    return compute_alignment<Layout>(std::vector<T>(data1.begin(), data1.end()),
+                                     std::vector<T>(data2.begin(), data2.end()), arch, parallel, granularity);
+  }
+
+  /**
+   * @brief Compute the largest total weight of a common subsequence, where matching data1[i] with data2[j] weighs
+   * weight(i, j)
+   *
+   * Read row by row, each row with its columns descending, the arrows turn common subsequences into increasing
+   * subsequences of their columns (as in compute_as_lis), which LIS::compute_weighted solves one dominance layer at a
+   * time. Weights may be negative, see there; weight is called concurrently when parallel.
+   */
+  template <typename Weight, typename W = std::decay_t<std::invoke_result_t<Weight &, int, int>>>
+  W compute_weighted(const std::vector<T> &data1, const std::vector<T> &data2, Weight weight, bool parallel = false,
+                     int granularity = 0) {
+    if (data1.empty() || data2.empty()) return W();
+    Stats::Solve solve("lcs_weighted", data1.size());
+    std::vector<uint32_t> columns;
+    std::vector<W> weights;
+    {
+      Stats::Phase phase("arrows");
+      build_arrows(data1, data2, arrows, arrow_buffers, parallel);
+      columns.resize(arrows.nnz());
+      weights.resize(arrows.nnz());
+      int n = arrows.size();
+#pragma omp parallel for schedule(dynamic, 64) if (parallel)
+      for (int i = 0; i < n; ++i) {
+        auto row = arrows.row(i);
+        for (size_t k = 0; k < row.size(); ++k) {
+          size_t state = arrows.offset(i) + k;
+          columns[state] = row[row.size() - 1 - k];
+          weights[state] = weight(i, static_cast<int>(columns[state]));
+        }
+      }
+    }
+    if (columns.empty()) return W();
+    return weighted_lis.compute_weighted(columns, weights, parallel, granularity);
+  }
+
+  template <typename Weight, typename W = std::decay_t<std::invoke_result_t<Weight &, int, int>>>
+  W compute_weighted(const std::string &data1, const std::string &data2, Weight weight, bool parallel = false,
+                     int granularity = 0) {
+    return compute_weighted(std::vector<T>(data1.begin(), data1.end()), std::vector<T>(data2.begin(), data2.end()),
+                            weight, parallel, granularity);
+  }
+
+ private:
+  // Run the Cordon rounds of compute_arrows on rows, which are swapped into the tree
+  template <typename Layout>
+  int cordon_rounds(ArrowsCSR<> &rows, ParallelArch arch, bool parallel, int granularity) {
+    if (arch == ParallelArch::GPU) return gpu_rounds(rows);
+    {
+      Stats::Phase phase("build");
+      make_tree<Layout>(rows, arch, parallel, granularity);
+    }
+
+    Stats::Phase phase("rounds");
     int round = 0;
     while (tree->global_min() < std::numeric_limits<int>::max()) {
       round++;
       tree->prefix_min();
+      Stats::round();
+    }
+    return round;
+  }
+
+  // Run the rounds of compute_arrows on the device, which keeps a copy of rows
+  int gpu_rounds(const ArrowsCSR<> &rows) {
+    {
+      Stats::Phase phase("build");
+      gpu.reset(rows.size(), rows.offsets_data(), rows.columns_data());
     }
-    auto end2 = std::chrono::high_resolution_clock::now();
-    std::cout << "LCS time: " << std::chrono::duration_cast<std::chrono::milliseconds>(end2 - end).count() << "ms"
-              << std::endl;
 
+    Stats::Phase phase("rounds");
+    int round = 0;
+    while (gpu.pending()) {
+      round++;
+      gpu.prefix_min();
+      Stats::round();
+    }
     return round;
   }
 
-  int compute_arrows_paralay(size_t n, const parlay::sequence<parlay::sequence<size_t>> &arrows,
-                             bool ifparallel = false, int granularity = 5000) {
+  // Run the rounds of compute_arrows_paralay on CSR arrows, where leaf l (1-indexed) reads row l - 1
+  template <typename Layout>
+  int paralay_csr(const ArrowsCSR<> &arrows, bool ifparallel, int granularity) {
+    if (arrows.size() == 0) return 0;
+    auto row = [&](size_t i) { return arrows.row(i - 1); };
+    size_t n = arrows.size();
+    return paralay_rounds<Layout>(n, row, ifparallel, paralay_granularity<Layout>(n, row, ifparallel, granularity));
+  }
+
+  /**
+   * @brief Build the prefix-min tree over the arrows for the given runtime, see rebuild
+   */
+  template <typename Layout>
+  void make_tree(ArrowsCSR<> &rows, ParallelArch arch, bool parallel, int granularity) {
+    granularity = Granularity::resolve(granularity, rows.size());
+    switch (arch) {
+      case ParallelArch::CILK:
+        return rebuild<SegmentTree<int, CilkScheduler, Layout>>(tree, rows, parallel, granularity);
+      case ParallelArch::OPENMP:
+        return rebuild<SegmentTree<int, OpenMPScheduler, Layout>>(tree, rows, parallel, granularity);
+      case ParallelArch::PARLAY:
+      case ParallelArch::CILK_OPT:
+      case ParallelArch::AUTO:
+        return rebuild<SegmentTree<int, ParlayScheduler, Layout>>(tree, rows, parallel, granularity);
+      case ParallelArch::NONE:
+        return rebuild<SegmentTree<int, SequentialScheduler, Layout>>(tree, rows, false, granularity);
+      case ParallelArch::TOURNAMENT:
+        // The tournament tree has a single implicit layout
+        return rebuild<TournamentTree<int>>(tree, rows, parallel, granularity);
+      default:
+        throw std::invalid_argument("Invalid parallel architecture");
+    }
+  }
+
+  // Swap rows into the tree in place if the previous solve used the same backend, otherwise replace the tree; either
+  // way rows is left holding storage that the next build refills
+  template <typename TreeType, typename V>
+  static void rebuild(std::unique_ptr<Tree<V>> &slot, ArrowsCSR<> &rows, bool parallel, int granularity) {
+    if (dynamic_cast<TreeType *>(slot.get())) {
+      slot->reset(rows, std::numeric_limits<V>::max(), parallel, granularity);
+    } else {
+      slot = std::make_unique<TreeType>(std::move(rows), std::numeric_limits<V>::max(), parallel, granularity);
+      rows = ArrowsCSR<>();
+    }
+  }
+
+  // Resolve AUTO_GRANULARITY for paralay_rounds by timing the rounds over the first rows, which are the LCS instance
+  // of a prefix of the first sequence and so stress the tree like the whole input
+  template <typename Layout, typename RowOf>
+  int paralay_granularity(size_t n, RowOf row, bool ifparallel, int granularity) {
+    if (granularity != AUTO_GRANULARITY) return granularity;
+    if (!ifparallel) return Granularity::heuristic(n);
+    size_t sample = std::min(n, std::max<size_t>(n / 32, 1 << 14));
+    return Granularity::tune("lcs_rounds", n, sample, [&](int g) {
+      // Sample runs are recorded on their own, so that they do not count as rounds of the solve being tuned for
+      Stats::Solve solve("lcs_tuning", sample);
+      paralay_rounds<Layout>(sample, row, true, g);
+    });
+  }
+
+  // Rounds of compute_arrows_paralay over leaves 1..n, where row(l) returns the arrows of leaf l; the root of the
+  // tree array is node 0 for every Layout
+  template <typename Layout, typename RowOf>
+  int paralay_rounds(size_t n, RowOf row, bool ifparallel, int granularity) {
 
     // Learn from code of original paper Parallel-Work-Efficient-Dynamic-Programming
     const size_t inf = std::numeric_limits<size_t>::max();
-    parlay::sequence<size_t> now(n + 1);
+    first_touch_vector<size_t> &now = leaf_now;
+    now.resize(n + 1);
+    Numa::distribute(now.data(), n + 1);
+    now[0] = 0;
 
     auto Read = [&](size_t i) {
-      if (now[i] >= arrows[i].size()) return inf;
-      return arrows[i][now[i]];
+      const auto &ys = row(i);
+      if (now[i] >= ys.size()) return inf;
+      return static_cast<size_t>(ys[now[i]]);
     };
 
-    parlay::sequence<size_t> tree(4 * n);
+    first_touch_vector<size_t> &tree = leaf_tree;
+    tree.resize(Layout::capacity(n));
 
+    // Leaves clear their own counter, so that the pages of now are first written by the worker walking them
     std::function<void(size_t, size_t, size_t)> Construct = [&](size_t x, size_t l, size_t r) {
       if (l == r) {
+        now[l] = 0;
         tree[x] = Read(l);
         return;
       }
-      size_t mid = (l + r) / 2;
+      size_t mid = (l + r) / 2, lx = Layout::lc(x, l, r), rx = Layout::rc(x, l, r);
       bool parallel = ifparallel && r - l > granularity;
       conditional_par_do(
-          parallel, [&]() { Construct(lc(x), l, mid); }, [&]() { Construct(rc(x), mid + 1, r); });
-      tree[x] = std::min(tree[lc(x)], tree[rc(x)]);
+          parallel, [&]() { Construct(lx, l, mid); }, [&]() { Construct(rx, mid + 1, r); });
+      tree[x] = std::min(tree[lx], tree[rx]);
     };
 
     std::function<void(size_t, size_t, size_t, size_t)> PrefixMin = [&](size_t x, size_t l, size_t r, size_t pre) {
+      Stats::node();
       if (tree[x] > pre) return;
       if (l == r) {
-        auto &ys = arrows[l];
-        if (now[l] + 8 >= ys.size() || ys[now[l] + 8] > pre) {
-          while (now[l] < ys.size() && ys[now[l]] <= pre) {
+        const auto &ys = row(l);
+        size_t consumed = now[l];
+        if (now[l] + 8 >= ys.size() || static_cast<size_t>(ys[now[l] + 8]) > pre) {
+          while (now[l] < ys.size() && static_cast<size_t>(ys[now[l]]) <= pre) {
             now[l]++;
           }
         } else {
           now[l] = std::upper_bound(ys.begin() + now[l], ys.end(), pre) - ys.begin();
         }
+        Stats::leaf();
+        Stats::frontier(now[l] - consumed);
         tree[x] = Read(l);
         return;
       }
-      size_t mid = (l + r) / 2;
-      if (tree[x] == tree[rc(x)]) {
-        if (tree[lc(x)] <= pre && tree[lc(x)] < inf) {
+      size_t mid = (l + r) / 2, lx = Layout::lc(x, l, r), rx = Layout::rc(x, l, r);
+      if (tree[x] == tree[rx]) {
+        if (tree[lx] <= pre && tree[lx] < inf) {
           bool parallel = ifparallel && r - l > granularity;
-          size_t lc_val = tree[lc(x)];
+          size_t lc_val = tree[lx];
+          if (parallel) Stats::spawn();
           conditional_par_do(
-              parallel, [&]() { PrefixMin(lc(x), l, mid, pre); }, [&]() { PrefixMin(rc(x), mid + 1, r, lc_val); });
+              parallel, [&]() { PrefixMin(lx, l, mid, pre); }, [&]() { PrefixMin(rx, mid + 1, r, lc_val); });
         } else {
-          PrefixMin(rc(x), mid + 1, r, pre);
+          PrefixMin(rx, mid + 1, r, pre);
         }
       } else {
-        PrefixMin(lc(x), l, mid, pre);
+        PrefixMin(lx, l, mid, pre);
       }
-      tree[x] = std::min(tree[lc(x)], tree[rc(x)]);
+      tree[x] = std::min(tree[lx], tree[rx]);
     };
 
-    Construct(1, 1, n);
-    size_t round = 0;
-    auto start = std::chrono::high_resolution_clock::now();
-    while (tree[1] < inf) {
-      round++;
-      PrefixMin(1, 1, n, inf);
+    {
+      Stats::Phase phase("build");
+      Construct(0, 1, n);
     }
-    auto end = std::chrono::high_resolution_clock::now();
-    // std::cout << "LCS time: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms"
-    //           << std::endl;
-    return round;
-  }
-
-  int compute_arrows_opt(const parlay::sequence<parlay::sequence<size_t>> &arrows, bool ifparallel = false,
-                         int granularity = 5000) {
-    auto start = std::chrono::high_resolution_clock::now();
-    tree_opt = std::make_unique<SegmentTreeCilkOpt<size_t>>(arrows, std::numeric_limits<size_t>::max(), ifparallel,
-                                                            granularity);
-    auto end = std::chrono::high_resolution_clock::now();
-    std::cout << "Prepare time: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms"
-              << std::endl;
-
-    int round = 0;
-    while (tree_opt->global_min() < std::numeric_limits<int>::max()) {
+    Stats::Phase phase("rounds");
+    size_t round = 0;
+    while (tree[0] < inf) {
       round++;
-      tree_opt->prefix_min();
+      PrefixMin(0, 1, n, inf);
+      Stats::round();
     }
-    auto end2 = std::chrono::high_resolution_clock::now();
-    std::cout << "LCS time: " << std::chrono::duration_cast<std::chrono::milliseconds>(end2 - end).count() << "ms"
-              << std::endl;
-
     return round;
   }
-
-  // without using arrows
-  int compute(const std::vector<T> &data1, const std::vector<T> &data2, ParallelArch arch = ParallelArch::CILK,
-              bool parallel = false, int granularity = 0) {
-    auto start = std::chrono::high_resolution_clock::now();
-    int n = data1.size(), m = data2.size();
-    if (n == 0 || m == 0) return 0;
-
-    std::vector<std::vector<int>> arrows(n, std::vector<int>(0));
-
-    std::unordered_map<T, std::vector<int>> data2_to_indices;
-    for (int j = 0; j < m; j++) {
-      data2_to_indices[data2[j]].push_back(j);
-    }
-
-    // Get the effective states: (i, j) pairs where data1[i] == data2[j]
-    for (int i = 0; i < n; i++) {
-      auto it = data2_to_indices.find(data1[i]);
-      if (it != data2_to_indices.end()) {
-        for (int j : it->second) {
-          arrows[i].push_back(j);
-        }
-      }
-    }
-
-    auto end = std::chrono::high_resolution_clock::now();
-    std::cout << "Prepare time: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms"
-              << std::endl;
-
-    return compute_arrows(arrows, arch, parallel, granularity);
-  }
-
-  int compute(const std::string &data1, const std::string &data2, ParallelArch arch = ParallelArch::CILK,
-              bool parallel = false, int granularity = 0) {
-    return compute(std::vector<T>(data1.begin(), data1.end()), std::vector<T>(data2.begin(), data2.end()), arch,
-                   parallel, granularity);
-  }
 };
\ No newline at end of file
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "parlay/parallel.h"
+
+/**
+ * @brief Count the LCS arrows of a against b, i.e. the pairs (i, j) with a[i] == b[j], without building them
+ *
+ * Costs O((n + m) log m) time and one sorted copy of b; T only needs operator<.
+ */
+template <typename T>
+size_t count_arrows(const std::vector<T> &a, const std::vector<T> &b) {
+  std::vector<T> sorted(b);
+  std::sort(sorted.begin(), sorted.end());
+  size_t arrows = 0;
+  for (const T &x : a) {
+    auto range = std::equal_range(sorted.begin(), sorted.end(), x);
+    arrows += static_cast<size_t>(range.second - range.first);
+  }
+  return arrows;
+}
+
+/**
+ * @brief Word-level bit-parallel LCS (Allison-Dix / Hyyro) for dense matches.
+ *
+ * The columns of the shorter sequence b are packed into a bit vector V, initially all ones. Row i applies
+ * V = (V + (V & M)) | (V & ~M), where M marks the columns j with b[j] == a[i], and the LCS length is the number of
+ * zero bits left in V. A row costs m / 64 word operations whatever the number of matches, so this beats the arrow
+ * solvers when the arrows are dense (small alphabets), where their Theta(nm / sigma) arrows would not fit in memory.
+ *
+ * The only dependency inside a row is the carry of the addition, which runs from lower to higher words. The matrix is
+ * therefore cut into tiles of tile_rows rows by tile_words words: tile (r, c) continues the bit vector of column block
+ * c left by tile (r - 1, c), and the carries of its rows left by tile (r, c - 1). The tiles of one anti-diagonal are
+ * independent and run in parallel; one carry bit per row suffices, since each row block has a single tile per
+ * anti-diagonal.
+ *
+ * Memory is one mask of m bits per distinct symbol of b, plus V and one carry byte per row of a; all of it is kept
+ * between calls.
+ *
+ * @tparam T The element type (must support operator<)
+ */
+template <typename T>
+class BitParallelLCS {
+ public:
+  static constexpr size_t WORD = 64;
+
+  /**
+   * @param tile_rows The number of rows of a tile
+   * @param tile_words The number of 64-bit words (of 64 columns each) of a tile
+   */
+  explicit BitParallelLCS(size_t tile_rows = 2048, size_t tile_words = 32)
+      : tile_rows(std::max<size_t>(tile_rows, 1)), tile_words(std::max<size_t>(tile_words, 1)) {}
+
+  /**
+   * @brief Whether the bit-parallel solver is expected to beat the arrow solvers on these inputs: its n * m / 64 word
+   * operations do not exceed the number of arrows
+   */
+  static bool preferred(const std::vector<T> &a, const std::vector<T> &b) {
+    if (a.empty() || b.empty()) return false;
+    return count_arrows(a, b) * WORD >= a.size() * b.size();
+  }
+
+  /**
+   * @brief Compute the LCS length of a and b
+   *
+   * @param parallel Whether the tiles of an anti-diagonal are processed in parallel
+   */
+  int compute(const std::vector<T> &a, const std::vector<T> &b, bool parallel = false) {
+    if (a.empty() || b.empty()) return 0;
+    // The bit vector runs over the shorter sequence
+    if (b.size() > a.size()) return compute(b, a, parallel);
+    prepare(a, b, parallel);
+
+    size_t n = a.size();
+    size_t row_blocks = (n + tile_rows - 1) / tile_rows;
+    size_t column_blocks = (words + tile_words - 1) / tile_words;
+    for (size_t t = 0; t < row_blocks + column_blocks - 1; ++t) {
+      size_t first = t >= column_blocks ? t - column_blocks + 1 : 0;
+      size_t last = std::min(row_blocks - 1, t);
+      if (parallel && last > first) {
+        parlay::parallel_for(first, last + 1, [&](size_t r) { run_tile(r, t - r); }, 1);
+      } else {
+        for (size_t r = first; r <= last; ++r) run_tile(r, t - r);
+      }
+    }
+
+    // Padding bits above m never match and stay set, so every zero bit is a column of the LCS
+    size_t ones = 0;
+    for (uint64_t x : v) ones += __builtin_popcountll(x);
+    return static_cast<int>(words * WORD - ones);
+  }
+
+ private:
+  size_t tile_rows;
+  size_t tile_words;
+  size_t words = 0;             // Words of the bit vector, ceil(m / 64)
+  std::vector<uint64_t> masks;  // masks[s * words + w]: columns of symbol s of b
+  std::vector<int> row_symbol;  // Symbol of every row of a, or -1 if it does not occur in b
+  std::vector<uint64_t> v;      // The bit vector
+  std::vector<uint8_t> carry;   // Carry into the next column block of every row
+  std::vector<T> alphabet;      // Distinct symbols of b, sorted
+
+  // Number the symbols of b, build their masks and map every row of a to its symbol
+  void prepare(const std::vector<T> &a, const std::vector<T> &b, bool parallel) {
+    size_t n = a.size(), m = b.size();
+    words = (m + WORD - 1) / WORD;
+    alphabet.assign(b.begin(), b.end());
+    std::sort(alphabet.begin(), alphabet.end());
+    alphabet.erase(std::unique(alphabet.begin(), alphabet.end(), [](const T &x, const T &y) { return !(x < y); }),
+                   alphabet.end());
+    auto symbol = [&](const T &x) {
+      auto it = std::lower_bound(alphabet.begin(), alphabet.end(), x);
+      return it != alphabet.end() && !(x < *it) ? static_cast<int>(it - alphabet.begin()) : -1;
+    };
+
+    masks.assign(alphabet.size() * words, 0);
+    for (size_t j = 0; j < m; ++j) {
+      masks[symbol(b[j]) * words + j / WORD] |= uint64_t(1) << (j % WORD);
+    }
+    row_symbol.resize(n);
+    if (parallel) {
+      parlay::parallel_for(0, n, [&](size_t i) { row_symbol[i] = symbol(a[i]); });
+    } else {
+      for (size_t i = 0; i < n; ++i) row_symbol[i] = symbol(a[i]);
+    }
+    v.assign(words, ~uint64_t(0));
+    carry.assign(n, 0);
+  }
+
+  void run_tile(size_t r, size_t c) {
+    size_t row_end = std::min(row_symbol.size(), (r + 1) * tile_rows);
+    size_t word_begin = c * tile_words, word_end = std::min(words, (c + 1) * tile_words);
+    for (size_t i = r * tile_rows; i < row_end; ++i) {
+      // A row without matches leaves V unchanged and never carries
+      if (row_symbol[i] < 0) continue;
+      const uint64_t *match = masks.data() + static_cast<size_t>(row_symbol[i]) * words;
+      uint64_t in = carry[i];
+      for (size_t w = word_begin; w < word_end; ++w) {
+        uint64_t x = v[w], u = x & match[w];
+        uint64_t sum = x + u;
+        uint64_t out = sum < x;
+        sum += in;
+        out |= sum < in;
+        v[w] = sum | (x & ~match[w]);
+        in = out;
+      }
+      carry[i] = static_cast<uint8_t>(in);
+    }
+  }
+};
\ No newline at end of file
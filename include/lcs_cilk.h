@@ -57,7 +57,7 @@ class LCS {
 
   int compute_arrows(std::vector<std::vector<int>> &arrows, bool parallel = false, int granularity = 0) {
     auto start = std::chrono::high_resolution_clock::now();
-    SegmentTree<int> tree(arrows, std::numeric_limits<int>::max(), parallel, granularity);
+    SegmentTreeCilk<int> tree(arrows, std::numeric_limits<int>::max(), parallel, granularity);
     auto end = std::chrono::high_resolution_clock::now();
     std::cout << ", Tree building time: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
     int round = 0;
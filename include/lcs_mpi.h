@@ -0,0 +1,198 @@
+#pragma once
+
+#include <mpi.h>
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "arrows.h"
+#include "granularity.h"
+#include "lcs.h"
+#include "segment_tree.h"
+#include "stats.h"
+
+/**
+ * @brief LCS over the ranks of an MPI communicator, each rank holding a contiguous range of the rows (leaves).
+ *
+ * A Cordon round sweeps the leaves from left to right and advances each one past the minimum of the leaves before it
+ * (see SegmentTree::prefix_min). Rank r holds the rows after those of ranks 0..r-1, so in every round it only needs
+ * the minimum of their leaves at the start of the round; that is all the ranks exchange. Rank r receives the running
+ * minimum from rank r - 1, forwards it to rank r + 1 after folding in the minimum of its own tree, and only then
+ * sweeps its tree with prefix_min(pre). The carry therefore reaches the last rank while the earlier ranks are still
+ * sweeping, and all ranks work on the same round at once.
+ *
+ * The last rank thus learns the minimum of all leaves at the start of every round and sends it back to rank 0, which
+ * passes it down the chain with the carry of the next round: once a round found no arrow left, every rank stops.
+ * This costs one sweep that finds nothing, but no collective per round. The round count, which every rank returns,
+ * and the rounds recorded with Stats match compute_arrows_paralay on the whole input.
+ *
+ * MPI must be initialized, with one DistributedLCS per rank of the communicator; the calls are collective.
+ *
+ *   MPI_Init(&argc, &argv);
+ *   DistributedLCS<> lcs;
+ *   int length = lcs.compute(a, b, true);  // Every rank passes a and b and builds the arrows of its rows only
+ *
+ * @tparam TreeType The Tree<int> backend each rank sweeps its rows with
+ */
+template <typename TreeType = SegmentTree<int, OpenMPScheduler>>
+class DistributedLCS {
+ private:
+  static constexpr int CARRY_TAG = 1;   // Running minimum and stop flag, from rank r - 1 to rank r
+  static constexpr int GLOBAL_TAG = 2;  // Minimum of all leaves, from the last rank to rank 0
+  static constexpr int INF = std::numeric_limits<int>::max();
+
+  MPI_Comm comm;
+  int rank = 0;
+  int ranks = 1;
+  std::unique_ptr<TreeType> tree;  // Tree over the rows of this rank, null if it holds none
+  ArrowsCSR<> arrows;              // Arrows of the last compute(), swapped with the rows of the tree
+  ArrowBuffers arrow_buffers;      // Scratch arrays of build_arrows
+
+ public:
+  /**
+   * @throws std::runtime_error if MPI has not been initialized
+   */
+  explicit DistributedLCS(MPI_Comm comm = MPI_COMM_WORLD) : comm(comm) {
+    int initialized = 0;
+    MPI_Initialized(&initialized);
+    if (!initialized) {
+      throw std::runtime_error("DistributedLCS needs MPI to be initialized");
+    }
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &ranks);
+  }
+
+  int rank_id() const { return rank; }
+
+  int size() const { return ranks; }
+
+  /**
+   * @brief Compute the LCS of data1 and data2, given in full on every rank; each rank builds the arrows of an equal
+   * share of the rows of data1
+   */
+  template <typename T>
+  int compute(const std::vector<T> &data1, const std::vector<T> &data2, bool parallel = false,
+              int granularity = AUTO_GRANULARITY) {
+    size_t first = data1.size() * rank / ranks, last = data1.size() * (rank + 1) / ranks;
+    std::vector<T> rows(data1.begin() + first, data1.begin() + last);
+    if (rows.empty() || data2.empty()) {
+      arrows = ArrowsCSR<>(first_touch_vector<size_t>(rows.size() + 1, 0), first_touch_vector<uint32_t>());
+    } else {
+      build_arrows(rows, data2, arrows, arrow_buffers, parallel);
+    }
+    return compute_local(arrows, parallel, granularity);
+  }
+
+  /**
+   * @brief Compute the LCS of arrows given in full on every rank, e.g. borrowed from the same arrow file (see
+   * load_arrows), so that a rank only reads the pages of its rows; the rows are split by partition()
+   */
+  int compute_arrows(const ArrowsCSR<> &all, bool parallel = false, int granularity = AUTO_GRANULARITY) {
+    std::vector<size_t> bounds = partition(all, ranks);
+    arrows = slice(all, bounds[rank], bounds[rank + 1]);
+    return compute_local(arrows, parallel, granularity);
+  }
+
+  /**
+   * @brief Run the rounds over rows already split between the ranks: rank r holds the rows after those of ranks
+   * 0..r-1, possibly none. The rows are swapped into the tree.
+   *
+   * @return The LCS length of all rows, on every rank
+   */
+  int compute_local(ArrowsCSR<> &rows, bool parallel = false, int granularity = AUTO_GRANULARITY) {
+    Stats::Solve solve("lcs_mpi", rows.size());
+    {
+      Stats::Phase phase("build");
+      build_tree(rows, parallel, Granularity::resolve(granularity, rows.size()));
+    }
+
+    Stats::Phase phase("rounds");
+    int outgoing[2];  // Carry and stop flag, or the minimum of all leaves on the last rank
+    MPI_Request request = MPI_REQUEST_NULL;
+    int previous = INF;  // Minimum of all leaves at the start of the previous round, on rank 0
+    for (int sweep = 0;; ++sweep) {
+      int carry = INF, done = 0;
+      if (rank > 0) {
+        int incoming[2];
+        MPI_Recv(incoming, 2, MPI_INT, rank - 1, CARRY_TAG, comm, MPI_STATUS_IGNORE);
+        carry = incoming[0];
+        done = incoming[1];
+      } else if (sweep > 0) {
+        if (ranks > 1) MPI_Recv(&previous, 1, MPI_INT, ranks - 1, GLOBAL_TAG, comm, MPI_STATUS_IGNORE);
+        done = previous == INF;
+      }
+      // The previous sweep found arrows, so it was a round
+      if (sweep > 0 && !done) Stats::round();
+
+      int local = tree ? tree->global_min() : INF;
+      MPI_Wait(&request, MPI_STATUS_IGNORE);
+      outgoing[0] = std::min(carry, local);
+      outgoing[1] = done;
+      if (rank + 1 < ranks) {
+        MPI_Isend(outgoing, 2, MPI_INT, rank + 1, CARRY_TAG, comm, &request);
+      } else if (!done) {
+        if (ranks > 1) {
+          MPI_Isend(outgoing, 1, MPI_INT, 0, GLOBAL_TAG, comm, &request);
+        } else {
+          previous = outgoing[0];
+        }
+      }
+      if (done) {
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+        return sweep - 1;
+      }
+      if (local < INF) tree->prefix_min(carry);
+    }
+  }
+
+  /**
+   * @brief Split the rows into parts contiguous ranges of about equal cost, a row costing its arrows plus one
+   *
+   * @return parts + 1 row boundaries, part p holding rows [bounds[p], bounds[p + 1])
+   */
+  static std::vector<size_t> partition(const ArrowsCSR<> &all, int parts) {
+    size_t n = all.size(), total = all.nnz() + n;
+    std::vector<size_t> bounds(parts + 1, n);
+    bounds[0] = 0;
+    for (int p = 1; p < parts; ++p) {
+      // The rows before row i cost offset(i) + i, which grows with i
+      size_t target = total * p / parts, lo = bounds[p - 1], hi = n;
+      while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (all.offset(mid) + mid < target) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      bounds[p] = lo;
+    }
+    return bounds;
+  }
+
+  /**
+   * @brief Copy rows [first, last) of all into owned rows
+   */
+  static ArrowsCSR<> slice(const ArrowsCSR<> &all, size_t first, size_t last) {
+    first_touch_vector<size_t> offsets(last - first + 1);
+    for (size_t i = first; i <= last; ++i) offsets[i - first] = all.offset(i) - all.offset(first);
+    first_touch_vector<uint32_t> columns(all.columns_data() + all.offset(first),
+                                         all.columns_data() + all.offset(last));
+    return ArrowsCSR<>(std::move(offsets), std::move(columns));
+  }
+
+ private:
+  // Build the tree over rows, rebuilding the one of the previous call in place when there is one
+  void build_tree(ArrowsCSR<> &rows, bool parallel, int granularity) {
+    if (rows.size() == 0) {
+      tree.reset();
+    } else if (tree) {
+      tree->reset(rows, INF, parallel, granularity);
+    } else {
+      tree = std::make_unique<TreeType>(std::move(rows), INF, parallel, granularity);
+      rows = ArrowsCSR<>();
+    }
+  }
+};
\ No newline at end of file
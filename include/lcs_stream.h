@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "arrows.h"
+#include "granularity.h"
+#include "parlay/primitives.h"
+#include "segment_tree.h"
+#include "segment_tree_cilk_opt.h"
+#include "stats.h"
+
+/**
+ * @brief Out-of-core LCS: the first sequence A is consumed in chunks while only B, an index of B and the LCS frontier
+ * stay in memory.
+ *
+ * The frontier is the threshold array of Hunt-Szymanski: frontier[k] is the smallest column of B in which a common
+ * subsequence of length k + 1 of the rows read so far can end, so it is strictly increasing and its size is the LCS
+ * length. A chunk is solved with the usual Cordon rounds over its arrows, preceded by one synthetic row per threshold
+ * holding the single arrow frontier[k]. Each synthetic row by itself extends the chain of the one before, so it is
+ * consumed in round k + 1 exactly, and a chunk arrow in column j sees the thresholds below j as the prefix it
+ * extends. Thresholds below the first column of the chunk are seen by every arrow and are replaced by an offset;
+ * thresholds from its last column on are seen by none and are left out. The round in which the tree consumes every
+ * arrow (Tree::track_rounds) is the length of the longest common subsequence ending there, and the new frontier is
+ * the smallest column consumed in every round.
+ *
+ * Rows of A without a match in B are dropped as they are read, and the rows that match are buffered until their
+ * arrows reach the chunk budget, so memory is O(|B| + budget) however long A is. A chunk runs one round per threshold
+ * it carries plus one per unit of LCS growth, so the budget should be large against the LCS length.
+ *
+ *   StreamingLCS<int> lcs(b, 1 << 24, true);
+ *   std::ifstream file("a.bin", std::ios::binary);
+ *   lcs.append(file);
+ *   int length = lcs.length();
+ *
+ * @tparam T The element type (must support operator<)
+ */
+template <typename T>
+class StreamingLCS {
+ private:
+  using Column = uint32_t;
+  static constexpr Column NO_COLUMN = std::numeric_limits<Column>::max();
+
+  size_t budget;
+  bool parallel;
+  int granularity;
+  std::vector<T> symbols;         // Distinct elements of B, sorted
+  ArrowsCSR<Column> positions;    // Row s: the sorted positions of symbols[s] in B
+  std::vector<Column> frontier;   // Thresholds of the rows read so far
+  std::vector<uint32_t> pending;  // Symbols of the buffered rows
+  size_t pending_arrows = 0;      // Arrows of the buffered rows
+  ArrowsCSR<Column> arrows;       // Arrows of the current chunk, swapped with the rows of the tree
+  std::vector<int> consumed;      // Round in which every arrow of the chunk was consumed
+  std::unique_ptr<Tree<int>> tree;
+
+  // Symbol of x in B, or -1 if it does not occur in B
+  int64_t symbol(const T &x) const {
+    auto it = std::lower_bound(symbols.begin(), symbols.end(), x);
+    return it != symbols.end() && !(x < *it) ? it - symbols.begin() : -1;
+  }
+
+  // Buffer one row of A, solving the buffered rows once they hold the budget
+  void push(const T &x) {
+    int64_t s = symbol(x);
+    if (s < 0) return;
+    pending.push_back(static_cast<uint32_t>(s));
+    pending_arrows += positions.row(s).size();
+    if (pending_arrows >= budget) flush();
+  }
+
+  // Solve the buffered rows against the frontier and replace the frontier
+  void flush() {
+    if (pending.empty()) return;
+    Stats::Solve solve("lcs_chunk", pending.size());
+    std::optional<Stats::Phase> phase(std::in_place, "build");
+    Column first_column = NO_COLUMN, last_column = 0;
+    for (uint32_t s : pending) {
+      first_column = std::min(first_column, positions.row(s)[0]);
+      last_column = std::max(last_column, positions.row(s)[positions.row(s).size() - 1]);
+    }
+    size_t low = std::lower_bound(frontier.begin(), frontier.end(), first_column) - frontier.begin();
+    size_t high = std::lower_bound(frontier.begin(), frontier.end(), last_column) - frontier.begin();
+    size_t carried = high - low;
+
+    auto row_size = [&](size_t i) { return i < carried ? 1 : positions.row(pending[i - carried]).size(); };
+    arrows.assign(
+        carried + pending.size(), row_size,
+        [&](size_t i, Column *out) {
+          if (i < carried) {
+            out[0] = frontier[low + i];
+          } else {
+            auto row = positions.row(pending[i - carried]);
+            std::copy(row.begin(), row.end(), out);
+          }
+        },
+        parallel);
+    int g = Granularity::resolve(granularity, arrows.size());
+    if (tree) {
+      tree->reset(arrows, std::numeric_limits<int>::max(), parallel, g);
+    } else {
+      tree = std::make_unique<SegmentTree<int, ParlayScheduler>>(std::move(arrows), std::numeric_limits<int>::max(),
+                                                                  parallel, g);
+      arrows = ArrowsCSR<Column>();
+    }
+
+    phase.emplace("rounds");
+    tree->track_rounds(&consumed);
+    size_t rounds = 0;
+    while (tree->global_min() < std::numeric_limits<int>::max()) {
+      rounds++;
+      tree->prefix_min();
+      Stats::round();
+    }
+    phase.reset();
+    tree->track_rounds(nullptr);
+
+    // Synthetic rows only reproduce their own threshold; chunk arrows follow them in CSR order, one row per symbol
+    frontier.resize(std::max(frontier.size(), low + rounds), NO_COLUMN);
+    size_t k = carried;
+    for (uint32_t s : pending) {
+      for (Column j : positions.row(s)) {
+        Column &threshold = frontier[low + consumed[k++] - 1];
+        threshold = std::min(threshold, j);
+      }
+    }
+    pending.clear();
+    pending_arrows = 0;
+  }
+
+ public:
+  /**
+   * @brief Index the second sequence
+   *
+   * @param b The sequence kept in memory, at most 2^32 - 1 elements
+   * @param budget The number of arrows buffered before a chunk is solved
+   * @param parallel Whether the rounds of every chunk run in parallel
+   * @param granularity The cutoff of the tree, or AUTO_GRANULARITY
+   */
+  explicit StreamingLCS(const std::vector<T> &b, size_t budget = 1 << 24, bool parallel = false,
+                        int granularity = AUTO_GRANULARITY)
+      : budget(std::max<size_t>(budget, 1)), parallel(parallel), granularity(granularity) {
+    if (b.size() >= NO_COLUMN) {
+      throw std::invalid_argument("The indexed sequence is too long");
+    }
+    auto order = parlay::stable_sort(parlay::tabulate(b.size(), [](size_t j) { return static_cast<Column>(j); }),
+                                     [&](Column x, Column y) { return b[x] < b[y]; });
+    first_touch_vector<size_t> offsets(1, 0);
+    for (size_t k = 0; k < order.size(); ++k) {
+      if (k == 0 || b[order[k - 1]] < b[order[k]]) {
+        symbols.push_back(b[order[k]]);
+        if (k > 0) offsets.push_back(k);
+      }
+    }
+    if (!order.empty()) offsets.push_back(order.size());
+    positions = ArrowsCSR<Column>(std::move(offsets), first_touch_vector<Column>(order.begin(), order.end()));
+  }
+
+  /**
+   * @brief Read the next rows of A
+   */
+  template <typename Iterator>
+  void append(Iterator first, Iterator last) {
+    for (; first != last; ++first) push(*first);
+    flush();
+  }
+
+  void append(const std::vector<T> &chunk) { append(chunk.begin(), chunk.end()); }
+
+  /**
+   * @brief Read the rest of A from a binary stream of T records, holding at most one block of records at a time
+   */
+  void append(std::istream &in, size_t block = 1 << 16) {
+    static_assert(std::is_trivially_copyable_v<T>, "Binary streams need trivially copyable elements");
+    std::vector<T> buffer(std::max<size_t>(block, 1));
+    while (in) {
+      in.read(reinterpret_cast<char *>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(T)));
+      size_t count = static_cast<size_t>(in.gcount()) / sizeof(T);
+      for (size_t i = 0; i < count; ++i) push(buffer[i]);
+    }
+    flush();
+  }
+
+  /**
+   * @brief Get the LCS length of B and the rows of A read so far
+   */
+  int length() const { return static_cast<int>(frontier.size()); }
+
+  /**
+   * @brief Get the thresholds: entry k is the smallest position of B ending a common subsequence of length k + 1
+   */
+  const std::vector<Column> &thresholds() const { return frontier; }
+
+  /**
+   * @brief Forget the rows read so far and start a new A against the same B
+   */
+  void clear() {
+    frontier.clear();
+    pending.clear();
+    pending_arrows = 0;
+  }
+};
\ No newline at end of file
@@ -1,6 +1,20 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+
+#include "batch.h"
+#include "dominance_tree.h"
+#include "granularity.h"
+#include "parlay/primitives.h"
 #include "segment_tree.h"
+#include "stats.h"
 
 // struct PaddedInt {
 //     int value;
@@ -13,57 +27,362 @@
 //     }
 // };
 
+/**
+ * @brief Whether LIS may treat Compare as a strict weak order, i.e. rank the elements by it and run the frontier rounds
+ * of std::less on the ranks; specialize it for user comparators that are strict weak orders. Other comparators, such
+ * as the dominance order of LCS::compute_as_lis, finalize one state per round.
+ */
+template <typename Compare>
+struct is_strict_weak_order : std::false_type {};
+template <typename T>
+struct is_strict_weak_order<std::less<T>> : std::true_type {};
+template <typename T>
+struct is_strict_weak_order<std::greater<T>> : std::true_type {};
+
 // Use the Cordon algorithm to solve the Longest Increasing Subsequence (LIS) problem,
-// supporting any data type T and user-defined comparison functions.
-template <typename T, typename Compare = std::less<T>>
+// supporting any data type T and user-defined comparison functions. TreeType is the Tree<T> backend used to find the
+// cordon, e.g. SegmentTreeOpenMP<T> or TournamentTree<T>; it must be constructible from (data, inf, parallel,
+// granularity). The tree and the per-state buffers are kept between calls and rebuilt in place, so an LIS object that
+// solves many inputs only allocates when an input is larger than every earlier one. append() instead grows one input
+// and only solves the new elements, see there.
+template <typename T, typename Compare = std::less<T>, typename TreeType = SegmentTreeOpenMP<T>>
 class LIS {
  private:
-  std::unique_ptr<Tree<int>> tree;
+  std::unique_ptr<Tree<T>> tree;
+  std::vector<int> ranks;          // Ranks of the last compute()
+  std::vector<uint8_t> finalized;  // Finalized states of the general-order rounds, one byte per state for relax()
+  std::vector<T> tails;            // tails[k]: smallest element ending an increasing subsequence of length k + 1
+  std::vector<T> suffix;           // Input of the Cordon rounds of append()
+  std::vector<T> keys;             // Ranks of the elements under a strict weak order other than std::less
 
  public:
-  // The parameter cmp is a comparison function, defaulting to std::less<T>
+  // The parameter cmp is a comparison function, defaulting to std::less<T>: a strict weak order, or a partial order
+  // that operator< on T extends; granularity may be AUTO_GRANULARITY. Strict weak orders (see is_strict_weak_order)
+  // over arithmetic T take one round per LIS length, any other cmp one round per element
   int compute(const std::vector<T> &data, bool parallel = false, int granularity = 0, Compare cmp = Compare(),
               T inf_value = std::numeric_limits<T>::max()) {
     int n = data.size();
     if (n == 0) return 0;
+    ranks.assign(n, 0);
+    return compute_ranks(data, ranks, parallel, granularity, cmp, inf_value);
+  }
+
+  /**
+   * @brief Append elements to the input grown by earlier calls and return the LIS length of the whole input
+   *
+   * Only the threshold array tails is kept between calls: an element extends the longest subsequence whose tail it
+   * exceeds. Before the new elements, the Cordon rounds read the tails that some new element exceeds and that are not
+   * below the smallest new element, as an increasing run of synthetic elements: the k-th of them ends a subsequence
+   * of length k exactly, so every new element gets its true rank up to the number of tails below the smallest new
+   * element, which all precede it. The tails are then lowered to the smallest new element of every rank. Appends
+   * with fewer new elements than carried tails, and sequential ones, insert the elements one by one with a binary
+   * search over the tails instead. For m new elements an append therefore costs O(m log L) sequentially, or Cordon
+   * rounds over at most 2m elements, and never revisits the earlier input.
+   *
+   * cmp must be a strict weak order; the Cordon rounds are only used for std::less. compute() does not touch the
+   * appended input.
+   */
+  int append(const std::vector<T> &elements, bool parallel = false, int granularity = 0, Compare cmp = Compare(),
+             T inf_value = std::numeric_limits<T>::max()) {
+    if (elements.empty()) return tails.size();
+    if constexpr (std::is_same_v<Compare, std::less<T>>) {
+      auto [smallest, largest] = std::minmax_element(elements.begin(), elements.end(), cmp);
+      size_t low = std::lower_bound(tails.begin(), tails.end(), *smallest, cmp) - tails.begin();
+      size_t high = std::lower_bound(tails.begin(), tails.end(), *largest, cmp) - tails.begin();
+      if (parallel && elements.size() >= high - low) {
+        suffix.assign(tails.begin() + low, tails.begin() + high);
+        suffix.insert(suffix.end(), elements.begin(), elements.end());
+        ranks.assign(suffix.size(), 0);
+        int length = compute_ranks(suffix, ranks, parallel, granularity, cmp, inf_value);
+        tails.resize(std::max(tails.size(), low + length), inf_value);
+        for (size_t k = high - low; k < suffix.size(); ++k) {
+          T &tail = tails[low + ranks[k] - 1];
+          if (cmp(suffix[k], tail)) tail = suffix[k];
+        }
+        return tails.size();
+      }
+    }
+    for (const T &x : elements) {
+      auto it = std::lower_bound(tails.begin(), tails.end(), x, cmp);
+      if (it == tails.end()) {
+        tails.push_back(x);
+      } else {
+        *it = x;
+      }
+    }
+    return tails.size();
+  }
+
+  /**
+   * @brief Get the LIS length of the input grown by append()
+   */
+  int length() const { return tails.size(); }
+
+  /**
+   * @brief Forget the input grown by append()
+   */
+  void clear() { tails.clear(); }
+
+  /**
+   * @brief Compute the LIS length of many independent inputs, sequentially unless an input is an outlier of the
+   * batch, see Batch
+   *
+   * @param granularity The cutoff used for outliers, or AUTO_GRANULARITY
+   * @return The LIS length of every input
+   */
+  static std::vector<int> compute_batch(const std::vector<std::vector<T>> &inputs,
+                                        int granularity = AUTO_GRANULARITY, Compare cmp = Compare(),
+                                        T inf_value = std::numeric_limits<T>::max()) {
+    std::vector<int> lengths(inputs.size(), 0);
+    Batch::run<LIS>(
+        inputs.size(), [&](size_t k) { return inputs[k].size(); },
+        [&](LIS &solver, size_t k, bool parallel) {
+          lengths[k] = solver.compute(inputs[k], parallel, granularity, cmp, inf_value);
+        });
+    return lengths;
+  }
+
+  /**
+   * @brief Compute one longest increasing subsequence instead of only its length
+   *
+   * The Cordon rounds already determine the LIS length ending at every state; those ranks are grouped with a
+   * parallel stable sort, and the witness is then read backwards one rank at a time. Among the states of one rank
+   * that precede i, the last one is the smallest under a strict weak order, so each step is a binary search; for
+   * partial orders the step walks back from there, which scans every rank at most once.
+   *
+   * @return The indices of the subsequence in data, in ascending order
+   */
+  std::vector<int> compute_subsequence(const std::vector<T> &data, bool parallel = false, int granularity = 0,
+                                       Compare cmp = Compare(), T inf_value = std::numeric_limits<T>::max()) {
+    int n = data.size();
+    if (n == 0) return {};
+    std::vector<int> rank(n, 0);
+    int length = compute_ranks(data, rank, parallel, granularity, cmp, inf_value);
+
+    std::vector<size_t> first;
+    auto byRank = group_by_rank(rank, length, first);
+
+    std::vector<int> witness(length);
+    witness[length - 1] = byRank[first[length]];
+    for (int r = length - 1; r >= 1; --r) {
+      auto begin = byRank.begin() + first[r], end = byRank.begin() + first[r + 1];
+      auto it = std::lower_bound(begin, end, witness[r]);
+      while (!cmp(data[*(it - 1)], data[witness[r]])) --it;
+      witness[r - 1] = *(it - 1);
+    }
+    return witness;
+  }
+
+  /**
+   * @brief Compute the largest total weight of an increasing subsequence, where element i weighs weights[i]
+   *
+   * A predecessor of a state has a smaller rank, so the states of one rank, a dominance layer, only depend on the
+   * earlier layers. After the Cordon rounds have ranked the states, the layers are solved in order: every state of a
+   * layer queries a DominanceTree for its best predecessor, then the layer inserts its values, each batch in parallel.
+   * This takes L steps of O(log^2 n) depth and O(n log^2 n) work for an LIS of length L. Weights may be negative; a
+   * subsequence is extended by a predecessor only when that raises its weight, and the result is that of the best
+   * non-empty subsequence.
+   *
+   * cmp must be a strict weak order.
+   *
+   * @throws std::invalid_argument if weights and data differ in size
+   */
+  template <typename W>
+  W compute_weighted(const std::vector<T> &data, const std::vector<W> &weights, bool parallel = false,
+                     int granularity = 0, Compare cmp = Compare(), T inf_value = std::numeric_limits<T>::max()) {
+    if (weights.size() != data.size()) {
+      throw std::invalid_argument("The weights do not match the sequence");
+    }
+    int n = data.size();
+    if (n == 0) return W();
+    Stats::Solve solve("lis_weighted", n);
+    ranks.assign(n, 0);
+    int length = compute_ranks(data, ranks, parallel, granularity, cmp, inf_value);
+
+    std::optional<Stats::Phase> phase(std::in_place, "build");
+    std::vector<size_t> first;
+    auto byRank = group_by_rank(ranks, length, first);
+    DominanceTree<T, W, Compare> dominance(data, parallel, cmp);
+
+    phase.emplace("layers");
+    std::vector<W> value(n);
+    for (int r = 1; r <= length; ++r) {
+      int begin = first[r], end = first[r + 1];
+      bool split = parallel && end - begin >= PARALLEL_LAYER;
+#pragma omp parallel for schedule(static) if (split)
+      for (int k = begin; k < end; ++k) value[byRank[k]] = weights[byRank[k]] + dominance.query(byRank[k]);
+      if (r < length) {
+#pragma omp parallel for schedule(static) if (split)
+        for (int k = begin; k < end; ++k) dominance.insert(byRank[k], value[byRank[k]]);
+      }
+      Stats::frontier(end - begin);
+      Stats::round();
+    }
+    return *std::max_element(value.begin(), value.end());
+  }
+
+ private:
+  // Dominance layers with fewer states are solved sequentially by compute_weighted
+  static constexpr int PARALLEL_LAYER = 64;
+
+  /**
+   * @brief List the states rank by rank, each rank in ascending index order; first[r] is set to where rank r starts
+   */
+  static parlay::sequence<int> group_by_rank(const std::vector<int> &rank, int length, std::vector<size_t> &first) {
+    size_t n = rank.size();
+    auto byRank = parlay::stable_sort(parlay::tabulate(n, [](size_t i) { return static_cast<int>(i); }),
+                                      [&](int x, int y) { return rank[x] < rank[y]; });
+    first.assign(length + 2, n);
+    parlay::parallel_for(0, n, [&](size_t k) {
+      if (k == 0 || rank[byRank[k - 1]] != rank[byRank[k]]) first[rank[byRank[k]]] = k;
+    });
+    return byRank;
+  }
+
+  /**
+   * @brief Run the Cordon rounds, writing the length of the longest increasing subsequence ending at every state to
+   * rank, and return the overall length
+   */
+  int compute_ranks(const std::vector<T> &data, std::vector<int> &rank, bool parallel, int granularity, Compare cmp,
+                    T inf_value) {
+    Stats::Solve solve("lis", data.size());
+    granularity = Granularity::resolve(granularity, data.size());
+    if constexpr (std::is_same_v<Compare, std::less<T>>) {
+      return compute_frontier(data, rank, parallel, granularity, inf_value);
+    } else if constexpr (is_strict_weak_order<Compare>::value && std::is_arithmetic_v<T>) {
+      std::optional<size_t> classes;
+      {
+        Stats::Phase phase("build");
+        classes = rank_keys(data, parallel, cmp);
+      }
+      if (classes) return compute_frontier(keys, rank, parallel, granularity, static_cast<T>(*classes));
+    }
+    int n = data.size();
     // dp[i] represents the length of the longest increasing subsequence ending at data[i], initially set to 1
-    std::vector<int> dp(n, 1);
+    std::vector<int> &dp = rank;
+    std::fill(dp.begin(), dp.end(), 1);
     // finalized[i] indicates whether data[i] has been finalized
-    std::vector<bool> finalized(n, false);
-    // Used to query the index with minimum value in the non-finalized range
-    tree = std::make_unique<SegmentTreeOpenMP<T>>(data, inf_value, parallel, granularity);
-    // tree.print_tree();
-    int numFinalized = 0;
-    // Used to record the cordon index of the current round
-    int cordonIdx = -1;
+    finalized.assign(n, 0);
+    // Every state is finalized after all the states it extends
+    parlay::sequence<int> order;
+    {
+      Stats::Phase phase("build");
+      order = pivot_order(data, parallel, cmp);
+    }
+    Stats::Phase phase("rounds");
     int maxResult = 0;
     // Use the Cordon algorithm to process states in rounds until all states are finalized
-    while (numFinalized < n) {
-      // Find the index of "the smallest element in the current prefix"
-      cordonIdx = tree->find_min_index();
-      if (cordonIdx == -1) break;
-      const int CACHE_LINE = 64 / sizeof(int);
-      int dp_cordon = dp[cordonIdx];
-      int data_cordon = data[cordonIdx];
-
-#pragma omp parallel for schedule(dynamic, CACHE_LINE) firstprivate(dp_cordon, data_cordon)
-      for (int i = cordonIdx + 1; i < n; i++) {
-        if (!finalized[i] && cmp(data_cordon, data[i])) {
-          // #pragma omp critical
-          //           { dp[i] = std::max(dp[i], dp[cordonIdx] + 1); }
-          // #pragma omp atomic update
-          { dp[i] = std::max(dp[i], dp_cordon + 1); }
-        }
-      }
+    for (int cordonIdx : order) {
+      relax(data, dp, cordonIdx, parallel && n - cordonIdx > granularity, cmp);
 
       // Finalize the current state
-      finalized[cordonIdx] = true;
-      numFinalized++;
+      finalized[cordonIdx] = 1;
       maxResult = std::max(maxResult, dp[cordonIdx]);
-
-      tree->remove(cordonIdx);
+      Stats::frontier(1);
+      Stats::round();
     }
 
     return maxResult;
   }
+
+  /**
+   * @brief Replace every element by the number of equivalence classes of cmp below it, so that operator< orders the
+   * keys as cmp orders the elements and the frontier rounds of std::less apply
+   *
+   * @return The number of classes, the infinity of the rounds; empty if it or a key is not exact in T
+   */
+  std::optional<size_t> rank_keys(const std::vector<T> &data, bool parallel, Compare cmp) {
+    size_t n = data.size();
+    auto before = [&](int x, int y) { return cmp(data[x], data[y]); };
+    parlay::sequence<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    if (parallel) {
+      order = parlay::stable_sort(order, before);
+    } else {
+      std::sort(order.begin(), order.end(), before);
+    }
+    size_t classes = 1;
+    for (size_t k = 1; k < n; ++k) classes += cmp(data[order[k - 1]], data[order[k]]);
+    const size_t exact = std::is_floating_point_v<T> ? size_t(1) << std::numeric_limits<T>::digits
+                                                     : static_cast<size_t>(std::numeric_limits<T>::max());
+    if (classes > exact) return std::nullopt;
+
+    keys.resize(n);
+    size_t key = 0;
+    for (size_t k = 0; k < n; ++k) {
+      if (k > 0 && cmp(data[order[k - 1]], data[order[k]])) key++;
+      keys[order[k]] = static_cast<T>(key);
+    }
+    return classes;
+  }
+
+  /**
+   * @brief Order the states by cmp, and by operator< among the states cmp leaves unordered
+   *
+   * This extends cmp both when cmp is a strict weak order and when operator< on T already extends cmp (as the
+   * lexicographic order of pairs extends the dominance order of LCS::compute_as_lis), so a state never follows one
+   * that it extends. A minimum-value pivot is only right in the second case: under std::greater it would take the
+   * largest element first.
+   */
+  static parlay::sequence<int> pivot_order(const std::vector<T> &data, bool parallel, Compare cmp) {
+    auto before = [&](int x, int y) {
+      return cmp(data[x], data[y]) || (!cmp(data[y], data[x]) && data[x] < data[y]);
+    };
+    parlay::sequence<int> order(data.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (parallel) return parlay::stable_sort(order, before);
+    std::stable_sort(order.begin(), order.end(), before);
+    return order;
+  }
+
+  /**
+   * @brief Cordon LIS for the strict order: every round finalizes the whole frontier of prefix minima with a single
+   * pass over the tree, so the number of rounds equals the LIS length and the total work is O(n log n)
+   */
+  int compute_frontier(const std::vector<T> &data, std::vector<int> &rank, bool parallel, int granularity,
+                       T inf_value) {
+    {
+      Stats::Phase phase("build");
+      build_tree(data, parallel, granularity, inf_value);
+    }
+
+    Stats::Phase phase("rounds");
+    int round = 0;
+    while (tree->extract_frontier(round + 1, rank) > 0) {
+      round++;
+      Stats::round();
+    }
+    return round;
+  }
+
+  /**
+   * @brief Extend the subsequence ending at the cordon to every later state above it that is not finalized
+   *
+   * Every state is written by one iteration only, and static scheduling hands each thread one contiguous block of
+   * dp, so the writes need no atomics and threads only share the cache lines at the ends of their blocks. The body
+   * is branch-free over byte flags, so that the compiler turns each block into vector compares and maxima for
+   * arithmetic T (GCC leaves the same loop scalar under omp simd).
+   */
+  void relax(const std::vector<T> &data, std::vector<int> &dp, int cordon, bool parallel, Compare cmp) const {
+    const T pivot = data[cordon];
+    const int extended = dp[cordon] + 1;
+    const T *values = data.data();
+    const uint8_t *done = finalized.data();
+    int *length = dp.data();
+    int n = data.size();
+#pragma omp parallel for schedule(static) if (parallel)
+    for (int i = cordon + 1; i < n; i++) {
+      int candidate = (!done[i] & cmp(pivot, values[i])) ? extended : 0;
+      length[i] = std::max(length[i], candidate);
+    }
+  }
+
+  // Build the tree over data, rebuilding the one of the previous call in place when there is one
+  void build_tree(const std::vector<T> &data, bool parallel, int granularity, T inf_value) {
+    if (tree) {
+      tree->reset(data, inf_value, parallel, granularity);
+    } else {
+      tree = std::make_unique<TreeType>(data, inf_value, parallel, granularity);
+    }
+  }
 };
\ No newline at end of file
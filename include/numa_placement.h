@@ -0,0 +1,162 @@
+#pragma once
+
+#include <omp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "parlay/parallel.h"
+
+#ifdef PARALLELDP_NUMA
+#include <numa.h>
+#endif
+
+/**
+ * @brief Allocator that default-initializes elements, so that growing a vector leaves the new pages untouched.
+ *
+ * Linux places a page on the NUMA node of the thread that first writes it. A std::vector zero-fills new elements on
+ * the resizing thread, which puts a whole tree on one node; with this allocator the first write is the one of the
+ * parallel build instead, which runs the same recursion as the rounds, so every subtree lands near the worker that
+ * built it. Elements with a non-trivial constructor are still constructed.
+ */
+template <typename T>
+struct FirstTouchAllocator : std::allocator<T> {
+  template <typename U>
+  struct rebind {
+    using other = FirstTouchAllocator<U>;
+  };
+
+  FirstTouchAllocator() = default;
+
+  template <typename U>
+  FirstTouchAllocator(const FirstTouchAllocator<U> &) noexcept {}
+
+  template <typename U, typename... Args>
+  void construct(U *p, Args &&...args) {
+    if constexpr (sizeof...(Args) == 0) {
+      ::new (static_cast<void *>(p)) U;
+    } else {
+      ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+    }
+  }
+};
+
+template <typename T>
+using first_touch_vector = std::vector<T, FirstTouchAllocator<T>>;
+
+/**
+ * @brief NUMA mode of the Cordon rounds: leaf-indexed arrays are split into one slice per node, and workers are pinned
+ * to the node of their slice.
+ *
+ * The mode is off by default and turned on by enable() or by setting PARALLELDP_NUMA=1. Worker w of W runs on node
+ * w * N / W of N nodes, and the slice of leaves [k n / N, (k + 1) n / N) is bound to node k, so that the top levels of
+ * the leaf recursion split the leaves the way the workers are spread over the nodes. Node binding needs libnuma
+ * (build with PARALLELDP_NUMA defined, see the CMake option of the same name); without it workers are pinned to
+ * single CPUs round-robin and placement falls back to the parallel first touch of FirstTouchAllocator.
+ *
+ * OpenMP threads are pinned from one parallel region and parlay (Cilk) workers from a parallel loop over their ids,
+ * which is best effort: a worker that runs no iteration stays unpinned. OMP_PLACES=cores OMP_PROC_BIND=spread gives
+ * the same OpenMP placement without enable().
+ */
+class Numa {
+ public:
+  /**
+   * @brief Whether NUMA mode is on; on the first query that finds it on, the workers are pinned
+   */
+  static bool enabled() {
+    bool on = state().enabled;
+    if (on) std::call_once(state().pinned, pin_workers);
+    return on;
+  }
+
+  /**
+   * @brief Turn NUMA mode on or off, pinning the workers the first time it is turned on
+   */
+  static void enable(bool on = true) {
+    state().enabled = on;
+    if (on) std::call_once(state().pinned, pin_workers);
+  }
+
+  /**
+   * @brief Get the number of NUMA nodes, 1 without libnuma
+   */
+  static int nodes() {
+#ifdef PARALLELDP_NUMA
+    if (numa_available() >= 0) return numa_num_configured_nodes();
+#endif
+    return 1;
+  }
+
+  /**
+   * @brief Bind slice k of count elements to node k, in NUMA mode and with libnuma; pages already touched keep their
+   * node
+   */
+  template <typename T>
+  static void distribute(T *data, size_t count) {
+#ifdef PARALLELDP_NUMA
+    int parts = nodes();
+    if (!enabled() || parts <= 1 || count == 0) return;
+    const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    uintptr_t first = reinterpret_cast<uintptr_t>(data), last = reinterpret_cast<uintptr_t>(data + count);
+    for (int k = 0; k < parts; ++k) {
+      // Round the slice boundaries down to pages, keeping the slices disjoint
+      uintptr_t lo = (first + (last - first) * k / parts) & ~(page - 1);
+      uintptr_t hi = k + 1 == parts ? last : (first + (last - first) * (k + 1) / parts) & ~(page - 1);
+      if (hi > lo) numa_tonode_memory(reinterpret_cast<void *>(lo), hi - lo, k);
+    }
+#else
+    (void)data;
+    (void)count;
+#endif
+  }
+
+ private:
+  struct State {
+    bool enabled;
+    std::once_flag pinned;
+    State() {
+      const char *value = std::getenv("PARALLELDP_NUMA");
+      enabled = value && std::strcmp(value, "0") != 0;
+    }
+  };
+
+  static State &state() {
+    static State instance;
+    return instance;
+  }
+
+  // Pin the calling thread as worker `worker` of `workers`
+  static void pin(size_t worker, size_t workers) {
+#ifdef PARALLELDP_NUMA
+    if (nodes() > 1) {
+      numa_run_on_node(static_cast<int>(worker * nodes() / workers));
+      numa_set_localalloc();
+      return;
+    }
+#endif
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus <= 1) return;
+    // Spread the workers evenly over the CPUs, keeping neighbouring ids on neighbouring CPUs
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(static_cast<int>(worker * static_cast<size_t>(cpus) / workers), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+
+  static void pin_workers() {
+    if (!omp_in_parallel()) {
+#pragma omp parallel
+      pin(omp_get_thread_num(), omp_get_num_threads());
+    }
+    size_t workers = parlay::num_workers();
+    // Several iterations per worker, so that every worker is likely to run at least one
+    parlay::parallel_for(0, 8 * workers, [&](size_t) { pin(parlay::worker_id(), workers); }, 1);
+  }
+};
\ No newline at end of file
@@ -39,25 +39,14 @@ class ConvexGLWS {
   T compute(const std::vector<T> &data, std::function<T(int, int)> costFunc, Compare cmp);
 
  private:
+  // Best decision of every state, written in place by FindIntervals and reused across rounds
+  std::vector<int> decision;
+
   // FindIntervals: In the state interval [il, ir], find the best decision index
-  // from the candidate decision index interval [jl, jr].
-  std::vector<Interval> FindIntervals(int jl, int jr, int il, int ir, const std::vector<T> &dp,
-                                      std::function<T(int, int)> costFunc, Compare cmp) {
-    std::vector<Interval> intervals;
-    if (il > ir) return intervals;
-    if (il == ir) {
-      int bestCandidate = jl;
-      T bestValue = dp[bestCandidate] + costFunc(bestCandidate, il);
-      for (int j = jl + 1; j <= jr; j++) {
-        T candidate = dp[j] + costFunc(j, il);
-        if (cmp(candidate, bestValue)) {
-          bestValue = candidate;
-          bestCandidate = j;
-        }
-      }
-      intervals.push_back({il, ir, bestCandidate});
-      return intervals;
-    }
+  // from the candidate decision index interval [jl, jr] and store it in decision[il..ir].
+  void FindIntervals(int jl, int jr, int il, int ir, const std::vector<T> &dp,
+                     const std::function<T(int, int)> &costFunc, Compare cmp) {
+    if (il > ir) return;
     int im = (il + ir) / 2;
     int bestCandidate = jl;
     T bestValue = dp[bestCandidate] + costFunc(bestCandidate, im);
@@ -68,57 +57,44 @@ class ConvexGLWS {
         bestCandidate = j;
       }
     }
+    decision[im] = bestCandidate;
+    if (il == ir) return;
 
-    std::vector<Interval> leftIntervals, rightIntervals;
     // Determine if the problem size is large enough (i.e., the subproblem size exceeds the threshold)
     // to create tasks, preventing the overhead of overly fine-grained tasks.
+    // The two halves cover disjoint states, so the tasks never write the same slot.
     const int THRESHOLD = 20;
     if (ir - il > THRESHOLD) {
-#pragma omp task shared(leftIntervals)
-      { leftIntervals = FindIntervals(jl, bestCandidate, il, im - 1, dp, costFunc, cmp); }
-#pragma omp task shared(rightIntervals)
-      { rightIntervals = FindIntervals(bestCandidate, jr, im + 1, ir, dp, costFunc, cmp); }
+      // Without shared, the tasks would take firstprivate copies of dp and costFunc
+#pragma omp task shared(dp, costFunc)
+      FindIntervals(jl, bestCandidate, il, im - 1, dp, costFunc, cmp);
+#pragma omp task shared(dp, costFunc)
+      FindIntervals(bestCandidate, jr, im + 1, ir, dp, costFunc, cmp);
 #pragma omp taskwait
     } else {
       // For small subproblems, compute sequentially
-      leftIntervals = FindIntervals(jl, bestCandidate, il, im - 1, dp, costFunc, cmp);
-      rightIntervals = FindIntervals(bestCandidate, jr, im + 1, ir, dp, costFunc, cmp);
+      FindIntervals(jl, bestCandidate, il, im - 1, dp, costFunc, cmp);
+      FindIntervals(bestCandidate, jr, im + 1, ir, dp, costFunc, cmp);
     }
-
-    intervals.insert(intervals.end(), leftIntervals.begin(), leftIntervals.end());
-    intervals.push_back({im, im, bestCandidate});
-    intervals.insert(intervals.end(), rightIntervals.begin(), rightIntervals.end());
-    return intervals;
   }
 
   // Update the compressed best decision array B,
   void UpdateBest(int now, int cordon, int n, std::vector<T> &dp, std::vector<Interval> &B,
-                  std::function<T(int, int)> costFunc, Compare cmp) {
-    std::vector<Interval> B_new = FindIntervals(now + 1, cordon - 1, cordon, n - 1, dp, costFunc, cmp);
-    // Merge B_new with the old B: Keep the part of B_old that covers [0, cordon-1], then append B_new
-    std::vector<Interval> B_merged;
-    for (const auto &interval : B) {
-      if (interval.r < cordon) {
-        B_merged.push_back(interval);
+                  const std::function<T(int, int)> &costFunc, Compare cmp) {
+    if (decision.size() < static_cast<size_t>(n)) decision.resize(n);
+#pragma omp parallel
+#pragma omp single nowait
+    FindIntervals(now + 1, cordon - 1, cordon, n - 1, dp, costFunc, cmp);
+    // Keep the part of B that covers [0, cordon-1], then append the new decisions as runs in place
+    while (!B.empty() && B.back().l >= cordon) B.pop_back();
+    if (!B.empty() && B.back().r >= cordon) B.back().r = cordon - 1;
+    for (int l = cordon, r = cordon; l < n; l = r) {
+      while (r < n && decision[r] == decision[l]) ++r;
+      if (!B.empty() && B.back().j == decision[l] && B.back().r + 1 == l) {
+        B.back().r = r - 1;
+      } else {
+        B.push_back({l, r - 1, decision[l]});
       }
     }
-    for (const auto &interval : B_new) {
-      B_merged.push_back(interval);
-    }
-    // Simply merge adjacent intervals with the same best decision
-    if (!B_merged.empty()) {
-      std::vector<Interval> B_compact;
-      B_compact.push_back(B_merged[0]);
-      for (size_t i = 1; i < B_merged.size(); i++) {
-        if (B_merged[i].j == B_compact.back().j && B_merged[i].l == B_compact.back().r + 1) {
-          B_compact.back().r = B_merged[i].r;
-        } else {
-          B_compact.push_back(B_merged[i]);
-        }
-      }
-      B = B_compact;
-    } else {
-      B = B_merged;
-    }
   }
 };
\ No newline at end of file
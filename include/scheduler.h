@@ -0,0 +1,47 @@
+#pragma once
+
+#include <omp.h>
+
+/**
+ * @brief Scheduler policies for the array-backed trees.
+ *
+ * A scheduler provides run(parallel, f), which executes a whole-tree operation inside whatever parallel context its
+ * runtime needs, and par_do(left, right), which executes two independent subtree operations, possibly in parallel.
+ * The OpenCilk and Parlay schedulers live in segment_tree_cilk.h and segment_tree_cilk_opt.h so that this header does
+ * not depend on either runtime.
+ */
+struct SequentialScheduler {
+  template <typename F>
+  static void run(bool, F &&f) {
+    f();
+  }
+
+  template <typename Left, typename Right>
+  static void par_do(Left &&left, Right &&right) {
+    left();
+    right();
+  }
+};
+
+struct OpenMPScheduler {
+  template <typename F>
+  static void run(bool parallel, F &&f) {
+    if (parallel) {
+#pragma omp parallel
+      {
+#pragma omp single nowait
+        { f(); }
+      }
+    } else {
+      f();
+    }
+  }
+
+  template <typename Left, typename Right>
+  static void par_do(Left &&left, Right &&right) {
+#pragma omp task shared(left)
+    { left(); }
+    right();
+#pragma omp taskwait
+  }
+};
\ No newline at end of file
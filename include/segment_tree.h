@@ -12,7 +12,12 @@
 #include <string>
 #include <vector>
 
+#include "arrows.h"
+#include "numa_placement.h"
+#include "scheduler.h"
+#include "stats.h"
 #include "tree.h"
+#include "tree_layout.h"
 #include "utils.h"
 
 /**
@@ -23,58 +28,57 @@
  * parallel modes for improved performance on large datasets.
  *
  * @tparam T The data type stored in the segment tree (must support comparison)
+ * @tparam Scheduler How subtrees are processed in parallel (SequentialScheduler, OpenMPScheduler, CilkScheduler,
+ * ParlayScheduler)
+ * @tparam Layout The node layout of the tree array, see tree_layout.h
  */
-template <typename T>
-class SegmentTreeOpenMP : public Tree<T> {
+template <typename T, typename Scheduler = OpenMPScheduler, typename Layout = HeapLayout>
+class SegmentTree : public Tree<T> {
  private:
-  std::vector<T> tree;       // The segment tree array
-  size_t n;                  // Number of leaf nodes
-  T infinity;                // Value representing infinity
-  bool constructed = false;  // Flag to track if tree has been constructed
+  first_touch_vector<T> tree;  // The segment tree array, first written by the parallel build
+  size_t n;                    // Number of leaf nodes
+  T infinity;                  // Value representing infinity
+  bool constructed = false;    // Flag to track if tree has been constructed
 
   // For LCS prefix minimum operation
   bool prefix_mode = false;
-  std::vector<size_t> now;
-  std::vector<std::vector<T>> arrows;
-  int granularity = 1000;
+  first_touch_vector<size_t> now;
+  ArrowsCSR<arrow_column_t<T>> arrows;
+  size_t granularity = 1000;
   bool parallel = false;
-
-  // std::atomic<int> task_count{0};
+  int rounds = 0;                           // Number of prefix_min calls so far
+  std::vector<int> *arrow_round = nullptr;  // Consuming round of every arrow, see track_rounds
 
   /**
    * @brief Get the index of the left child of a node
    * @param x The index of the parent node
+   * @param l Left boundary of the parent's segment
+   * @param r Right boundary of the parent's segment
    * @return The index of the left child
    */
-  inline size_t lc(size_t x) const { return 2 * x + 1; }
+  inline size_t lc(size_t x, size_t l, size_t r) const { return Layout::lc(x, l, r); }
 
   /**
    * @brief Get the index of the right child of a node
    * @param x The index of the parent node
+   * @param l Left boundary of the parent's segment
+   * @param r Right boundary of the parent's segment
    * @return The index of the right child
    */
-  inline size_t rc(size_t x) const { return 2 * x + 2; }
-
-  /**
-   * @brief Get the index of the parent node
-   * @param x The index of a child node
-   * @return The index of the parent node
-   */
-  inline size_t parent(size_t x) const { return (x - 1) / 2; }
+  inline size_t rc(size_t x, size_t l, size_t r) const { return Layout::rc(x, l, r); }
 
   /**
    * @brief Internal recursive function to build the segment tree
    *
-   * @param arr Reference to the input data array
+   * @param leaf Function returning the initial value of a leaf
    * @param x Current node index in the segment tree
    * @param l Left boundary of the current segment
    * @param r Right boundary of the current segment
-   * @param parallel Whether to build the tree in parallel
-   * @param granularity The minimum size of a subtree to process in parallel
    */
-  void build_recursive(const std::vector<T> &arr, size_t x, size_t l, size_t r) {
+  template <typename Leaf>
+  void build_recursive(const Leaf &leaf, size_t x, size_t l, size_t r) {
     if (l == r) {
-      tree[x] = (l < arr.size()) ? arr[l] : infinity;
+      tree[x] = leaf(l);
       return;
     }
 
@@ -82,17 +86,14 @@ class SegmentTreeOpenMP : public Tree<T> {
     bool do_parallel = parallel && (r - l > granularity);
 
     if (do_parallel) {
-#pragma omp task shared(arr, tree)
-      { build_recursive(arr, lc(x), l, mid); }
-#pragma omp task shared(arr, tree)
-      { build_recursive(arr, rc(x), mid + 1, r); }
-#pragma omp taskwait
+      Scheduler::par_do([&]() { build_recursive(leaf, lc(x, l, r), l, mid); },
+                        [&]() { build_recursive(leaf, rc(x, l, r), mid + 1, r); });
     } else {
-      build_recursive(arr, lc(x), l, mid);
-      build_recursive(arr, rc(x), mid + 1, r);
+      build_recursive(leaf, lc(x, l, r), l, mid);
+      build_recursive(leaf, rc(x, l, r), mid + 1, r);
     }
 
-    tree[x] = std::min(tree[lc(x)], tree[rc(x)]);
+    tree[x] = std::min(tree[lc(x, l, r)], tree[rc(x, l, r)]);
   }
 
   /**
@@ -118,8 +119,8 @@ class SegmentTreeOpenMP : public Tree<T> {
 
     // If the current segment is partially inside the query range
     size_t mid = (l + r) / 2;
-    T left_min = query_recursive(lc(x), l, mid, ql, qr);
-    T right_min = query_recursive(rc(x), mid + 1, r, ql, qr);
+    T left_min = query_recursive(lc(x, l, r), l, mid, ql, qr);
+    T right_min = query_recursive(rc(x, l, r), mid + 1, r, ql, qr);
     return std::min(left_min, right_min);
   }
 
@@ -143,14 +144,50 @@ class SegmentTreeOpenMP : public Tree<T> {
 
     size_t mid = (l + r) / 2;
     if (pos <= mid) {
-      update_recursive(lc(x), l, mid, pos, new_val);
+      update_recursive(lc(x, l, r), l, mid, pos, new_val);
     } else {
-      update_recursive(rc(x), mid + 1, r, pos, new_val);
+      update_recursive(rc(x, l, r), mid + 1, r, pos, new_val);
     }
 
-    tree[x] = std::min(tree[lc(x)], tree[rc(x)]);
+    tree[x] = std::min(tree[lc(x, l, r)], tree[rc(x, l, r)]);
     // std::cout << "update_recursive: tree[x] = " << tree[x] << std::endl;
-    // std::cout << "left_child: " << tree[lc(x)] << ", right_child: " << tree[rc(x)] << std::endl;
+    // std::cout << "left_child: " << tree[lc(x, l, r)] << ", right_child: " << tree[rc(x, l, r)] << std::endl;
+  }
+
+  /**
+   * @brief Internal function to overwrite a sorted batch of leaves, recomputing each affected node once
+   *
+   * @param x Current node index in the segment tree
+   * @param l Left boundary of the current segment
+   * @param r Right boundary of the current segment
+   * @param first First batch position inside [l, r]
+   * @param last One past the last batch position inside [l, r]
+   * @param value Function returning the new value for a batch entry, given a pointer to its position
+   */
+  template <typename Value>
+  void batch_recursive(size_t x, size_t l, size_t r, const size_t *first, const size_t *last, const Value &value) {
+    if (first == last) {
+      return;
+    }
+
+    // A repeated position takes the value of its last occurrence
+    if (l == r) {
+      tree[x] = value(last - 1);
+      return;
+    }
+
+    size_t mid = (l + r) / 2;
+    const size_t *split = std::upper_bound(first, last, mid);
+
+    if (parallel && r - l > granularity && first != split && split != last) {
+      Scheduler::par_do([&]() { batch_recursive(lc(x, l, r), l, mid, first, split, value); },
+                        [&]() { batch_recursive(rc(x, l, r), mid + 1, r, split, last, value); });
+    } else {
+      batch_recursive(lc(x, l, r), l, mid, first, split, value);
+      batch_recursive(rc(x, l, r), mid + 1, r, split, last, value);
+    }
+
+    tree[x] = std::min(tree[lc(x, l, r)], tree[rc(x, l, r)]);
   }
 
   /**
@@ -160,32 +197,37 @@ class SegmentTreeOpenMP : public Tree<T> {
    * @param l Left boundary of the current segment
    * @param r Right boundary of the current segment
    * @param pre The prefix value
-   * @param arrows The array of arrow sequences
-   * @param now The current indices in the arrow sequences
-   * @param parallel Whether to perform the operation in parallel
-   * @param granularity The minimum size of a subtree to process in parallel
    */
   void prefix_min_recursive(size_t x, size_t l, size_t r, T pre) {
+    Stats::node();
     // Early return if this node's value is already greater than pre
-    // std::cout << "prefix_min_recursive: x = " << x << ", l = " << l << ", r = " << r << ", pre = " << pre;
     if (tree[x] > pre) {
       return;
     }
 
     // If we've reached a leaf node
     if (l == r) {
-      const auto &ys = arrows[l];
+      const auto ys = arrows.row(l);
 
       // Check if we need to do binary search or linear search
-      if (now[l] + 8 >= ys.size() || ys[now[l] + 8] > pre) {
+      size_t consumed = now[l];
+      if (now[l] + 8 >= ys.size() || static_cast<T>(ys[now[l] + 8]) > pre) {
         // Linear search (small range)
-        while (now[l] < ys.size() && ys[now[l]] <= pre) {
+        while (now[l] < ys.size() && static_cast<T>(ys[now[l]]) <= pre) {
           now[l]++;
         }
       } else {
         // Binary search (large range)
-        now[l] = std::upper_bound(ys.begin() + now[l], ys.end(), pre) - ys.begin();
+        now[l] = std::upper_bound(ys.begin() + now[l], ys.end(), pre,
+                                  [](const T &v, const arrow_column_t<T> &a) { return v < static_cast<T>(a); }) -
+                 ys.begin();
+      }
+      if (arrow_round) {
+        std::fill(arrow_round->begin() + arrows.offset(l) + consumed,
+                  arrow_round->begin() + arrows.offset(l) + now[l], rounds);
       }
+      Stats::leaf();
+      Stats::frontier(now[l] - consumed);
 
       // Update the tree value after the index change
       tree[x] = read(l);
@@ -195,39 +237,28 @@ class SegmentTreeOpenMP : public Tree<T> {
     size_t mid = (l + r) / 2;
 
     // Optimize the traversal based on which child has the minimum value
-    if (tree[x] == tree[rc(x)]) {
-      if (tree[lc(x)] <= pre && tree[lc(x)] < infinity) {
+    if (tree[x] == tree[rc(x, l, r)]) {
+      if (tree[lc(x, l, r)] <= pre && tree[lc(x, l, r)] < infinity) {
         bool do_parallel = (r - l > granularity) && parallel;
-        T lc_val = tree[lc(x)];
+        T lc_val = tree[lc(x, l, r)];
 
         if (do_parallel) {
-          // task_count.fetch_add(1);
-          // std::cout << "do_parallel" << std::endl;
-          // #pragma omp single
-          // {
-          //   printf("Current working threads: %d\n", omp_get_num_threads());
-          // }
-#pragma omp task
-          { prefix_min_recursive(lc(x), l, mid, pre); }
-          // #pragma omp task
-          { prefix_min_recursive(rc(x), mid + 1, r, lc_val); }
-#pragma omp taskwait
+          Stats::spawn();
+          Scheduler::par_do([&]() { prefix_min_recursive(lc(x, l, r), l, mid, pre); },
+                            [&]() { prefix_min_recursive(rc(x, l, r), mid + 1, r, lc_val); });
         } else {
-          // std::cout << "do_not_parallel: " << "l: " << l << ", mid: " << mid << ", r: " << r << std::endl;
-          prefix_min_recursive(lc(x), l, mid, pre);
-          prefix_min_recursive(rc(x), mid + 1, r, lc_val);
+          prefix_min_recursive(lc(x, l, r), l, mid, pre);
+          prefix_min_recursive(rc(x, l, r), mid + 1, r, lc_val);
         }
       } else {
-        // std::cout << "only right" << std::endl;
-        prefix_min_recursive(rc(x), mid + 1, r, pre);
+        prefix_min_recursive(rc(x, l, r), mid + 1, r, pre);
       }
     } else {
-      // std::cout << "only left" << std::endl;
-      prefix_min_recursive(lc(x), l, mid, pre);
+      prefix_min_recursive(lc(x, l, r), l, mid, pre);
     }
 
     // Update this node's value
-    tree[x] = std::min(tree[lc(x)], tree[rc(x)]);
+    tree[x] = std::min(tree[lc(x, l, r)], tree[rc(x, l, r)]);
   }
 
  public:
@@ -236,19 +267,12 @@ class SegmentTreeOpenMP : public Tree<T> {
    *
    * @param arr The input array to build the tree from
    * @param inf_value The value to use as infinity (default: maximum value of type T)
+   * @param parallel Whether to build and update the tree in parallel
+   * @param granularity The minimum size of a subtree to process in parallel
    */
-  SegmentTreeOpenMP(const std::vector<T> &arr, T inf_value = std::numeric_limits<T>::max(), bool parallel = false,
-                    size_t granularity = 1000)
+  SegmentTree(const std::vector<T> &arr, T inf_value = std::numeric_limits<T>::max(), bool parallel = false,
+              size_t granularity = 1000)
       : n(arr.size()), infinity(inf_value), prefix_mode(false), granularity(granularity), parallel(parallel) {
-    // std::cout << "SegmentTree init" << std::endl;
-    // std::cout << "arr: " << std::endl;
-    // for (size_t i = 0; i < arr.size(); ++i) {
-    //   std::cout << arr[i] << " ";
-    // }
-    // std::cout << std::endl;
-    // std::cout << "inf_value: " << inf_value << std::endl;
-    // std::cout << "parallel: " << parallel << std::endl;
-    // std::cout << "granularity: " << granularity << std::endl;
     if (arr.empty()) {
       throw std::invalid_argument("Input array cannot be empty");
     }
@@ -256,43 +280,51 @@ class SegmentTreeOpenMP : public Tree<T> {
       // TODO: A current workaround for string comparison
       infinity = "zzzzzzzzzzzzzzzzzzzz";
     }
-    tree.resize(4 * n, inf_value);
+    tree.resize(Layout::capacity(n), inf_value);
     build(arr);
   }
 
   /**
    * @brief Construct a new Segment Tree for LCS prefix minimum operation
    *
-   * @param _arrows The input array of arrow sequences
+   * @param _arrows The arrow rows in CSR storage, one leaf per row
    * @param inf_value The value to use as infinity (default: maximum value of type T)
-   * @param parallel Whether to build the tree in parallel
-   * @param granularity The minimum size of a subtree to process in parallel
+   * @param _parallel Whether to build and update the tree in parallel
+   * @param _granularity The minimum size of a subtree to process in parallel
    */
-  SegmentTreeOpenMP(std::vector<std::vector<T>> _arrows, T inf_value = std::numeric_limits<T>::max(),
-                    bool _parallel = false, size_t _granularity = 1000)
+  SegmentTree(ArrowsCSR<arrow_column_t<T>> _arrows, T inf_value = std::numeric_limits<T>::max(),
+              bool _parallel = false, size_t _granularity = 1000)
       : n(_arrows.size()),
         infinity(inf_value),
-        arrows(_arrows),
         prefix_mode(true),
+        arrows(std::move(_arrows)),
         granularity(_granularity),
         parallel(_parallel) {
-    std::cout << "SegmentTree Prefix mode init" << std::endl;
-    std::cout << "inf_value: " << inf_value << std::endl;
-    std::cout << "parallel: " << parallel << std::endl;
-    std::cout << "granularity: " << granularity << std::endl;
+    if (n == 0) {
+      throw std::invalid_argument("Arrow sequences cannot be empty");
+    }
     if constexpr (std::is_same_v<T, std::string>) {
       // TODO: A current workaround for string comparison
       infinity = "zzzzzzzzzzzzzzzzzzzz";
     }
-    tree.resize(4 * n, inf_value);
-    now.resize(n, 0);
-    std::vector<T> arr(n);
-    for (size_t i = 0; i < n; ++i) {
-      arr[i] = read(i);
-    }
-    build(arr);
+    tree.resize(Layout::capacity(n));
+    now.resize(n);
+    build_arrows();
   }
 
+  /**
+   * @brief Construct a new Segment Tree for LCS prefix minimum operation from nested arrow rows
+   *
+   * @param _arrows Any indexable sequence of sorted rows (std::vector, parlay::sequence, ...), copied into CSR storage
+   * @param inf_value The value to use as infinity (default: maximum value of type T)
+   * @param _parallel Whether to build and update the tree in parallel
+   * @param _granularity The minimum size of a subtree to process in parallel
+   */
+  template <typename Nested, typename = decltype(std::declval<const Nested &>()[0].size())>
+  SegmentTree(const Nested &_arrows, T inf_value = std::numeric_limits<T>::max(), bool _parallel = false,
+              size_t _granularity = 1000)
+      : SegmentTree(ArrowsCSR<arrow_column_t<T>>::from_nested(_arrows), inf_value, _parallel, _granularity) {}
+
   /**
    * @brief Print the segment tree in a tree-like structure
    *
@@ -361,10 +393,10 @@ class SegmentTreeOpenMP : public Tree<T> {
     size_t mid = (l + r) / 2;
 
     // Print left child
-    print_subtree(lc(x), depth + 1, l, mid, current_depth + 1, max_depth, indent + "│  ", show_indices);
+    print_subtree(lc(x, l, r), depth + 1, l, mid, current_depth + 1, max_depth, indent + "│  ", show_indices);
 
     // Print right child
-    print_subtree(rc(x), depth + 1, mid + 1, r, current_depth + 1, max_depth, indent + "   ", show_indices);
+    print_subtree(rc(x, l, r), depth + 1, mid + 1, r, current_depth + 1, max_depth, indent + "   ", show_indices);
   }
 
  public:
@@ -399,7 +431,7 @@ class SegmentTreeOpenMP : public Tree<T> {
    *
    * @return A const reference to the tree array
    */
-  const std::vector<T> &get_tree() const { return tree; }
+  const first_touch_vector<T> &get_tree() const { return tree; }
 
   /**
    * @brief Build the segment tree from an array
@@ -418,19 +450,46 @@ class SegmentTreeOpenMP : public Tree<T> {
       throw std::invalid_argument("Input array size exceeds segment tree capacity");
     }
 
-    if (parallel) {
-#pragma omp parallel
-      {
-#pragma omp single nowait
-        { build_recursive(arr, 0, 0, n - 1); }
-      }
-    } else {
-      build_recursive(arr, 0, 0, n - 1);
-    }
+    auto leaf = [&](size_t i) { return i < arr.size() ? arr[i] : infinity; };
+    Scheduler::run(parallel, [&]() { build_recursive(leaf, 0, 0, n - 1); });
 
     constructed = true;
   }
 
+  /**
+   * @brief Rebuild the tree over a new array, reusing the node storage of earlier builds
+   *
+   * @param arr The input array to build the tree from
+   * @param _parallel Whether to build and update the tree in parallel
+   * @param _granularity The minimum size of a subtree to process in parallel
+   * @throws std::invalid_argument if the array is empty
+   */
+  void reset(const std::vector<T> &arr, T inf_value, bool _parallel, size_t _granularity) override {
+    if (arr.empty()) {
+      throw std::invalid_argument("Input array cannot be empty");
+    }
+    restart(arr.size(), false, inf_value, _parallel, _granularity);
+    build(arr);
+  }
+
+  /**
+   * @brief Rebuild the tree for LCS prefix minimum operation over new arrow rows, see Tree::reset
+   *
+   * @param _arrows The arrow rows, swapped with the rows of the previous build
+   * @param _parallel Whether to build and update the tree in parallel
+   * @param _granularity The minimum size of a subtree to process in parallel
+   * @throws std::invalid_argument if there are no rows
+   */
+  void reset(ArrowsCSR<arrow_column_t<T>> &_arrows, T inf_value, bool _parallel, size_t _granularity) override {
+    if (_arrows.size() == 0) {
+      throw std::invalid_argument("Arrow sequences cannot be empty");
+    }
+    arrows.swap(_arrows);
+    restart(arrows.size(), true, inf_value, _parallel, _granularity);
+    now.resize(n);
+    build_arrows();
+  }
+
   /**
    * @brief Query the minimum value in a range
    *
@@ -472,14 +531,14 @@ class SegmentTreeOpenMP : public Tree<T> {
     while (left < right) {
       size_t mid = (left + right) / 2;
 
-      T left_min = tree[lc(node_idx)];
-      T right_min = tree[rc(node_idx)];
+      T left_min = tree[lc(node_idx, left, right)];
+      T right_min = tree[rc(node_idx, left, right)];
 
       if (left_min <= right_min) {
-        node_idx = lc(node_idx);
+        node_idx = lc(node_idx, left, right);
         right = mid;
       } else {
-        node_idx = rc(node_idx);
+        node_idx = rc(node_idx, left, right);
         left = mid + 1;
       }
     }
@@ -512,15 +571,20 @@ class SegmentTreeOpenMP : public Tree<T> {
    *
    * Updates the segment tree based on prefix minimum values from arrow sequences.
    *
-   * @param pre The prefix value
-   * @param arrows The array of arrow sequences
-   * @param now The current indices in the arrow sequences
-   * @param parallel Whether to perform the operation in parallel
-   * @param granularity The minimum size of a subtree to process in parallel
    * @throws std::invalid_argument if the arrow sequences or now indices are invalid
    * @throws std::runtime_error if the tree has not been constructed
    */
-  void prefix_min() override {
+  void prefix_min() override { prefix_min(infinity); }
+
+  /**
+   * @brief Perform the prefix minimum operation after leaves outside the tree whose minimum was pre, see
+   * Tree::prefix_min
+   *
+   * @param pre The prefix value, the running minimum entering the first leaf
+   * @throws std::invalid_argument if the arrow sequences or now indices are invalid
+   * @throws std::runtime_error if the tree has not been constructed
+   */
+  void prefix_min(T pre) override {
     if (!prefix_mode) {
       throw std::runtime_error("This is not Prefix mode");
     }
@@ -544,16 +608,24 @@ class SegmentTreeOpenMP : public Tree<T> {
       }
     }
 
-    if (parallel) {
-#pragma omp parallel
-      {
-#pragma omp single nowait
-        { prefix_min_recursive(0, 0, n - 1, infinity); }
-      }
-    } else {
-      prefix_min_recursive(0, 0, n - 1, infinity);
+    rounds++;
+    Scheduler::run(parallel, [&]() { prefix_min_recursive(0, 0, n - 1, pre); });
+  }
+
+  /**
+   * @brief Start or stop recording the round in which prefix_min consumes every arrow
+   *
+   * @param buffer Resized to one entry per arrow (0 until consumed), or nullptr to stop recording
+   * @throws std::runtime_error if the tree was not built from arrows
+   */
+  void track_rounds(std::vector<int> *buffer) override {
+    if (!prefix_mode) {
+      throw std::runtime_error("This is not Prefix mode");
+    }
+    if (buffer) {
+      buffer->assign(arrows.nnz(), 0);
     }
-    // std::cout << "Task count: " << task_count.load() << std::endl;
+    arrow_round = buffer;
   }
 
   /**
@@ -571,7 +643,7 @@ class SegmentTreeOpenMP : public Tree<T> {
     if (now[i] >= arrows[i].size()) {
       return std::numeric_limits<T>::max();  // Return infinity
     }
-    return arrows[i][now[i]];
+    return static_cast<T>(arrows[i][now[i]]);
   }
 
   /**
@@ -597,11 +669,165 @@ class SegmentTreeOpenMP : public Tree<T> {
     // for a min segment tree
     update_recursive(0, 0, n - 1, pos, infinity);
   }
+
+  /**
+   * @brief Remove a batch of positions at once
+   *
+   * The batch is split at every node by binary search, so only the O(k log(n / k)) nodes above the k removed leaves
+   * are recomputed, and independent subtrees are processed in parallel.
+   *
+   * @param positions Positions to remove, sorted ascending
+   * @throws std::invalid_argument if the positions are not sorted
+   * @throws std::out_of_range if a position is out of bounds
+   * @throws std::runtime_error if the tree has not been constructed
+   */
+  void remove_batch(const std::vector<size_t> &positions) override {
+    if (!constructed) {
+      throw std::runtime_error("Segment tree has not been constructed");
+    }
+    Tree<T>::check_batch(positions, n);
+    if (positions.empty()) {
+      return;
+    }
+
+    const size_t *first = positions.data();
+    Scheduler::run(parallel, [&]() {
+      batch_recursive(0, 0, n - 1, first, first + positions.size(), [&](const size_t *) { return infinity; });
+    });
+  }
+
+  /**
+   * @brief Set a batch of positions to new values at once, see remove_batch
+   *
+   * @param positions Positions to update, sorted ascending
+   * @param values New value of every position, in the same order
+   * @throws std::invalid_argument if the positions are not sorted or the sizes differ
+   * @throws std::out_of_range if a position is out of bounds
+   * @throws std::runtime_error if the tree has not been constructed
+   */
+  void update_batch(const std::vector<size_t> &positions, const std::vector<T> &values) override {
+    if (!constructed) {
+      throw std::runtime_error("Segment tree has not been constructed");
+    }
+    if (positions.size() != values.size()) {
+      throw std::invalid_argument("Batch positions and values differ in size");
+    }
+    Tree<T>::check_batch(positions, n);
+    if (positions.empty()) {
+      return;
+    }
+
+    const size_t *first = positions.data();
+    Scheduler::run(parallel, [&]() {
+      batch_recursive(0, 0, n - 1, first, first + positions.size(),
+                      [&](const size_t *it) { return values[it - first]; });
+    });
+  }
+
+  /**
+   * @brief Remove the whole frontier of prefix minima in one pass
+   *
+   * A leaf is on the frontier if no remaining leaf before it holds a strictly smaller value, i.e. it is a state of
+   * the strict LIS whose predecessors have all been finalized. Subtrees whose minimum exceeds the running prefix
+   * minimum are skipped, so the pass only walks the ancestors of the removed leaves.
+   *
+   * @param round The value written to rank for every removed leaf
+   * @param rank Output array indexed by leaf position
+   * @return The number of leaves removed
+   * @throws std::runtime_error if the tree has not been constructed
+   */
+  size_t extract_frontier(int round, std::vector<int> &rank) override {
+    if (!constructed) {
+      throw std::runtime_error("Segment tree has not been constructed");
+    }
+
+    if (rank.size() < n) {
+      throw std::invalid_argument("Rank array is smaller than the segment tree");
+    }
+
+    size_t removed = 0;
+    Scheduler::run(parallel, [&]() { removed = extract_frontier_recursive(0, 0, n - 1, infinity, round, rank); });
+    return removed;
+  }
+
+ private:
+  // Forget the previous build and size the node array for n leaves; resizing within the capacity does not allocate
+  void restart(size_t leaves, bool arrow_mode, T inf_value, bool _parallel, size_t _granularity) {
+    n = leaves;
+    infinity = inf_value;
+    if constexpr (std::is_same_v<T, std::string>) {
+      // TODO: A current workaround for string comparison
+      infinity = "zzzzzzzzzzzzzzzzzzzz";
+    }
+    prefix_mode = arrow_mode;
+    parallel = _parallel;
+    granularity = _granularity;
+    constructed = false;
+    rounds = 0;
+    arrow_round = nullptr;
+    tree.resize(Layout::capacity(n));
+  }
+
+  // Build the prefix-mode tree with no arrow consumed; every leaf clears its own position, so that in NUMA mode the
+  // pages of now and of the tree are first written by the workers that own them
+  void build_arrows() {
+    Numa::distribute(now.data(), n);
+    Scheduler::run(parallel, [&]() {
+      build_recursive(
+          [&](size_t i) {
+            now[i] = 0;
+            return read(i);
+          },
+          0, 0, n - 1);
+    });
+    constructed = true;
+  }
+
+  size_t extract_frontier_recursive(size_t x, size_t l, size_t r, T pre, int round, std::vector<int> &rank) {
+    Stats::node();
+    if (tree[x] > pre || !(tree[x] < infinity)) {
+      return 0;
+    }
+
+    if (l == r) {
+      rank[l] = round;
+      tree[x] = infinity;
+      Stats::leaf();
+      Stats::frontier(1);
+      return 1;
+    }
+
+    size_t mid = (l + r) / 2;
+    T left_min = tree[lc(x, l, r)];
+    T right_pre = std::min(pre, left_min);
+    size_t left_removed = 0, right_removed = 0;
+
+    if (parallel && r - l > granularity && left_min <= pre && tree[rc(x, l, r)] <= right_pre) {
+      Stats::spawn();
+      Scheduler::par_do(
+          [&]() { left_removed = extract_frontier_recursive(lc(x, l, r), l, mid, pre, round, rank); },
+          [&]() { right_removed = extract_frontier_recursive(rc(x, l, r), mid + 1, r, right_pre, round, rank); });
+    } else {
+      left_removed = extract_frontier_recursive(lc(x, l, r), l, mid, pre, round, rank);
+      right_removed = extract_frontier_recursive(rc(x, l, r), mid + 1, r, right_pre, round, rank);
+    }
+
+    tree[x] = std::min(tree[lc(x, l, r)], tree[rc(x, l, r)]);
+    return left_removed + right_removed;
+  }
 };
 
-template class SegmentTreeOpenMP<int>;
-template class SegmentTreeOpenMP<float>;
-template class SegmentTreeOpenMP<double>;
-template class SegmentTreeOpenMP<long>;
-template class SegmentTreeOpenMP<std::string>;
-template class SegmentTreeOpenMP<std::pair<int, int>>;
\ No newline at end of file
+/**
+ * @brief The OpenMP-task segment tree
+ */
+template <typename T, typename Layout = HeapLayout>
+using SegmentTreeOpenMP = SegmentTree<T, OpenMPScheduler, Layout>;
+
+template class SegmentTree<int, OpenMPScheduler>;
+template class SegmentTree<float, OpenMPScheduler>;
+template class SegmentTree<double, OpenMPScheduler>;
+template class SegmentTree<long, OpenMPScheduler>;
+template class SegmentTree<std::string, OpenMPScheduler>;
+template class SegmentTree<std::pair<int, int>, OpenMPScheduler>;
+template class SegmentTree<int, OpenMPScheduler, PreorderLayout>;
+template class SegmentTree<int, SequentialScheduler>;
\ No newline at end of file
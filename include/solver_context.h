@@ -0,0 +1,28 @@
+#pragma once
+
+#include "glws.h"
+#include "lcs.h"
+#include "lis.h"
+
+/**
+ * @brief Workspace for back-to-back solves: one solver of every kind with the buffers it keeps between calls.
+ *
+ * Every solver sizes its trees and per-state arrays to the largest input it has seen and rebuilds them in place
+ * (Tree::reset). Once the context has solved its largest inputs twice (the arrows of the first LCS solve move into its
+ * tree), LIS::compute, LCS::compute over at most SMALL_ALPHABET symbols and ConvexGLWS::compute with a plain cost do
+ * not allocate. Larger alphabets sort into fresh buffers, LIS::compute_weighted builds an O(n log n) DominanceTree
+ * per call, and cost models may rebuild their arrays in prepare(). A context is not thread safe; keep one per thread
+ * that solves.
+ *
+ *   SolverContext<int> context;
+ *   for (const auto &[a, b] : queries) lengths.push_back(context.lcs.compute(a, b, ParallelArch::PARLAY, true));
+ *
+ * @tparam T The element type of the sequences
+ * @tparam Cost The segment cost type of the GLWS solver, see ConvexGLWS
+ */
+template <typename T, typename Cost = GLWSCostFunction<T>>
+struct SolverContext {
+  LIS<T> lis;
+  LCS<T> lcs;
+  ConvexGLWS<T, Cost> glws;
+};
\ No newline at end of file
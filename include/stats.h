@@ -0,0 +1,299 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Per-round instrumentation of the Cordon solvers, compiled in when PARALLELDP_STATS is defined.
+ *
+ * A solve of LIS, LCS or GLWS opens a Stats::Solve record, times its phases with Stats::Phase and closes every Cordon
+ * round with Stats::round(). The tree recursions count the nodes they visit, the leaves they advance, the subtree
+ * pairs they spawn in parallel and the states they finalize (the frontier); round() stores the counts since the
+ * previous round together with its time. Records are kept for the process and exported with write_json() or, for
+ * chrome://tracing and Perfetto, with write_trace().
+ *
+ * Without PARALLELDP_STATS every hook is an empty inline function and no record is made, so the solvers pay nothing.
+ * With it, a counter update is a plain store to a per-thread slot. Counters are shared by the solves running at the
+ * same time, so the rounds of concurrent solves (Batch) mix their counts; their times stay exact.
+ *
+ *   #define PARALLELDP_STATS
+ *   LCS<int> lcs;
+ *   lcs.compute(a, b, ParallelArch::PARLAY, true);
+ *   std::ofstream trace("trace.json");
+ *   Stats::write_trace(trace);
+ */
+class Stats {
+ public:
+#ifdef PARALLELDP_STATS
+  static constexpr bool ENABLED = true;
+#else
+  static constexpr bool ENABLED = false;
+#endif
+
+  struct RoundRecord {
+    uint64_t frontier = 0;  // States finalized in the round
+    uint64_t nodes = 0;     // Tree nodes visited
+    uint64_t leaves = 0;    // Leaves advanced or removed
+    uint64_t spawns = 0;    // Subtree pairs run in parallel
+    double start = 0;       // Microseconds since the first record of the process
+    double time = 0;        // Microseconds
+  };
+
+  struct PhaseRecord {
+    std::string name;
+    double start = 0;
+    double time = 0;
+  };
+
+  struct SolveRecord {
+    std::string solver;
+    size_t size = 0;  // Number of states
+    double start = 0;
+    double time = 0;
+    std::vector<PhaseRecord> phases;
+    std::vector<RoundRecord> rounds;
+  };
+
+  /**
+   * @brief Record one solve from construction to destruction; solves opened inside it are recorded separately
+   */
+  class Solve {
+   public:
+    Solve(const char *solver, size_t size) {
+      if constexpr (ENABLED) {
+        outer = current();
+        {
+          std::lock_guard<std::mutex> lock(mutex());
+          records().emplace_back();
+          record = &records().back();
+        }
+        record->solver = solver;
+        record->size = size;
+        record->start = clock();
+        last = totals();
+        round_start = record->start;
+        current() = this;
+      }
+    }
+
+    ~Solve() {
+      if constexpr (ENABLED) {
+        record->time = clock() - record->start;
+        current() = outer;
+      }
+    }
+
+    Solve(const Solve &) = delete;
+    Solve &operator=(const Solve &) = delete;
+
+   private:
+    friend class Stats;
+    SolveRecord *record = nullptr;
+    Solve *outer = nullptr;
+    RoundRecord last;  // Counter totals at the end of the previous round
+    double round_start = 0;
+  };
+
+  /**
+   * @brief Time the enclosing scope as a phase of the current solve
+   */
+  class Phase {
+   public:
+    explicit Phase(const char *name) {
+      if constexpr (ENABLED) {
+        if (!current()) return;
+        solve = current();
+        solve->record->phases.push_back({name, clock(), 0});
+        index = solve->record->phases.size() - 1;
+        // The next round starts with the phase, leaving out the work of the earlier phases
+        solve->last = totals();
+        solve->round_start = solve->record->phases[index].start;
+      }
+    }
+
+    ~Phase() {
+      if constexpr (ENABLED) {
+        if (solve) solve->record->phases[index].time = clock() - solve->record->phases[index].start;
+      }
+    }
+
+    Phase(const Phase &) = delete;
+    Phase &operator=(const Phase &) = delete;
+
+   private:
+    Solve *solve = nullptr;
+    size_t index = 0;
+  };
+
+  static void node() {
+    if constexpr (ENABLED) bump(&Counters::nodes, 1);
+  }
+
+  static void leaf() {
+    if constexpr (ENABLED) bump(&Counters::leaves, 1);
+  }
+
+  static void spawn() {
+    if constexpr (ENABLED) bump(&Counters::spawns, 1);
+  }
+
+  static void frontier(uint64_t states) {
+    if constexpr (ENABLED) bump(&Counters::frontier, states);
+  }
+
+  /**
+   * @brief Close a round of the current solve of this thread, which began with the previous round or with the latest
+   * phase; rounds outside a solve are dropped
+   */
+  static void round() {
+    if constexpr (ENABLED) {
+      Solve *solve = current();
+      if (!solve) return;
+      RoundRecord now = totals();
+      RoundRecord r;
+      r.frontier = now.frontier - solve->last.frontier;
+      r.nodes = now.nodes - solve->last.nodes;
+      r.leaves = now.leaves - solve->last.leaves;
+      r.spawns = now.spawns - solve->last.spawns;
+      r.start = solve->round_start;
+      solve->round_start = clock();
+      r.time = solve->round_start - r.start;
+      solve->record->rounds.push_back(r);
+      solve->last = now;
+    }
+  }
+
+  /**
+   * @brief Get the solves recorded so far, in the order they started
+   */
+  static const std::deque<SolveRecord> &solves() { return records(); }
+
+  /**
+   * @brief Forget the recorded solves; must not run while a solve is open
+   */
+  static void clear() {
+    std::lock_guard<std::mutex> lock(mutex());
+    records().clear();
+  }
+
+  /**
+   * @brief Write the recorded solves as {"solves": [{"solver", "size", "time", "phases": [...], "rounds": [...]}]},
+   * with times in microseconds
+   */
+  static void write_json(std::ostream &out) {
+    std::lock_guard<std::mutex> lock(mutex());
+    out << "{\"solves\": [";
+    for (size_t s = 0; s < records().size(); ++s) {
+      const SolveRecord &solve = records()[s];
+      out << (s ? ", " : "") << "{\"solver\": \"" << solve.solver << "\", \"size\": " << solve.size
+          << ", \"start\": " << solve.start << ", \"time\": " << solve.time << ", \"phases\": [";
+      for (size_t p = 0; p < solve.phases.size(); ++p) {
+        const PhaseRecord &phase = solve.phases[p];
+        out << (p ? ", " : "") << "{\"name\": \"" << phase.name << "\", \"start\": " << phase.start
+            << ", \"time\": " << phase.time << "}";
+      }
+      out << "], \"rounds\": [";
+      for (size_t r = 0; r < solve.rounds.size(); ++r) {
+        const RoundRecord &round = solve.rounds[r];
+        out << (r ? ", " : "") << "{\"frontier\": " << round.frontier << ", \"nodes\": " << round.nodes
+            << ", \"leaves\": " << round.leaves << ", \"spawns\": " << round.spawns << ", \"start\": " << round.start
+            << ", \"time\": " << round.time << "}";
+      }
+      out << "]}";
+    }
+    out << "]}\n";
+  }
+
+  /**
+   * @brief Write the recorded solves in the Chrome trace event format: one complete event per solve, phase and
+   * round, the rounds carrying their counters as arguments, and one track per solve
+   */
+  static void write_trace(std::ostream &out) {
+    std::lock_guard<std::mutex> lock(mutex());
+    out << "{\"traceEvents\": [";
+    bool first = true;
+    auto event = [&](const std::string &name, const char *category, double start, double time, size_t track) {
+      out << (first ? "" : ",\n") << "{\"name\": \"" << name << "\", \"cat\": \"" << category
+          << "\", \"ph\": \"X\", \"ts\": " << start << ", \"dur\": " << time << ", \"pid\": 0, \"tid\": " << track;
+      first = false;
+    };
+    for (size_t s = 0; s < records().size(); ++s) {
+      const SolveRecord &solve = records()[s];
+      event(solve.solver, "solve", solve.start, solve.time, s);
+      out << ", \"args\": {\"size\": " << solve.size << ", \"rounds\": " << solve.rounds.size() << "}}";
+      for (const PhaseRecord &phase : solve.phases) {
+        event(phase.name, "phase", phase.start, phase.time, s);
+        out << "}";
+      }
+      for (size_t r = 0; r < solve.rounds.size(); ++r) {
+        const RoundRecord &round = solve.rounds[r];
+        event("round " + std::to_string(r + 1), "round", round.start, round.time, s);
+        out << ", \"args\": {\"frontier\": " << round.frontier << ", \"nodes\": " << round.nodes
+            << ", \"leaves\": " << round.leaves << ", \"spawns\": " << round.spawns << "}}";
+      }
+    }
+    out << "]}\n";
+  }
+
+ private:
+  // Written only by the owning thread and read by round(), so an update is a relaxed load and store
+  struct alignas(64) Counters {
+    std::atomic<uint64_t> frontier{0}, nodes{0}, leaves{0}, spawns{0};
+  };
+
+  static void bump(std::atomic<uint64_t> Counters::*counter, uint64_t amount) {
+    thread_local Counters *mine = [] {
+      std::lock_guard<std::mutex> lock(mutex());
+      slots().push_back(std::make_unique<Counters>());
+      return slots().back().get();
+    }();
+    std::atomic<uint64_t> &c = mine->*counter;
+    c.store(c.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+  }
+
+  static RoundRecord totals() {
+    std::lock_guard<std::mutex> lock(mutex());
+    RoundRecord sum;
+    for (const auto &slot : slots()) {
+      sum.frontier += slot->frontier.load(std::memory_order_relaxed);
+      sum.nodes += slot->nodes.load(std::memory_order_relaxed);
+      sum.leaves += slot->leaves.load(std::memory_order_relaxed);
+      sum.spawns += slot->spawns.load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+  static double clock() {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+  }
+
+  static Solve *&current() {
+    thread_local Solve *solve = nullptr;
+    return solve;
+  }
+
+  static std::mutex &mutex() {
+    static std::mutex m;
+    return m;
+  }
+
+  // Slots of threads that have exited are kept, so their counts stay in the totals
+  static std::vector<std::unique_ptr<Counters>> &slots() {
+    static std::vector<std::unique_ptr<Counters>> counters;
+    return counters;
+  }
+
+  // A deque, so that open solves keep their records while others are added
+  static std::deque<SolveRecord> &records() {
+    static std::deque<SolveRecord> solves;
+    return solves;
+  }
+};
\ No newline at end of file
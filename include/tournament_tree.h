@@ -1,23 +1,493 @@
 #pragma once
 
-#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
-template <typename T, typename Compare = std::less<T>>
-class TournamentTree {
+#include "arrows.h"
+#include "scheduler.h"
+#include "stats.h"
+#include "tree.h"
+
+/**
+ * @brief A lock-free min tournament tree over a flat node array.
+ *
+ * Leaves are stored implicitly after a power-of-two number of internal nodes, and internal node x (children 2x and
+ * 2x + 1, root 1) holds one 64-bit atomic word packing the index of the winning leaf of its subtree with a version
+ * counter. Leaf keys never move, so a node is refreshed by re-reading the winners of its two children and swapping in
+ * the better one with a single compare-and-swap; the version makes a refresh computed from stale children fail
+ * instead of overwriting a newer one.
+ *
+ * remove() may be called from many threads at once: it flags the leaf and refreshes every ancestor twice, which is
+ * enough for the tree to reflect the removal even if concurrent refreshes win both races (the refresh that beats the
+ * second attempt started after the first one, so it already saw the flag). Whole-tree operations (build, prefix_min,
+ * extract_frontier) recurse on disjoint subtrees and must not overlap each other or concurrent removals.
+ *
+ * @tparam T The key type (must support comparison)
+ * @tparam Scheduler How subtrees are processed in parallel, see scheduler.h
+ */
+template <typename T, typename Scheduler = OpenMPScheduler>
+class TournamentTree : public Tree<T> {
+ private:
+  static constexpr uint64_t LEAF_MASK = 0xffffffffULL;
+  static constexpr uint64_t VERSION_ONE = 1ULL << 32;
+
+  size_t n;                                 // Number of real leaves
+  size_t leaves;                            // Number of leaf slots, a power of two >= max(n, 2)
+  T infinity;                               // Value representing infinity
+  std::vector<T> keys;                      // Leaf keys
+  std::vector<std::atomic<uint8_t>> gone;   // Removal flags of the leaves
+  std::vector<std::atomic<uint64_t>> node;  // Version and winning leaf of every internal node, index 0 unused
+
+  // For LCS prefix minimum operation
+  bool prefix_mode = false;
+  std::vector<size_t> now;
+  ArrowsCSR<arrow_column_t<T>> arrows;
+  size_t granularity = 1000;
+  bool parallel = false;
+  int rounds = 0;                           // Number of prefix_min calls so far
+  std::vector<int> *arrow_round = nullptr;  // Consuming round of every arrow, see track_rounds
+
+  static size_t leaf_slots(size_t n) {
+    size_t slots = 2;
+    while (slots < n) slots <<= 1;
+    return slots;
+  }
+
+  /**
+   * @brief Get the current key of a leaf, or infinity if it is padding or has been removed
+   */
+  T key(size_t i) const { return (i < n && !gone[i].load()) ? keys[i] : infinity; }
+
+  /**
+   * @brief Get the winning leaf of a node, where nodes x >= leaves are the leaves themselves
+   */
+  size_t winner(size_t x) const { return x >= leaves ? x - leaves : static_cast<size_t>(node[x].load() & LEAF_MASK); }
+
+  /**
+   * @brief The better of the winners of x's children, preferring the left one on ties
+   */
+  size_t play(size_t x) const {
+    size_t left = winner(2 * x), right = winner(2 * x + 1);
+    return key(right) < key(left) ? right : left;
+  }
+
+  /**
+   * @brief Recompute node x from its children with one compare-and-swap
+   *
+   * @return false if another thread changed the node between the read and the swap
+   */
+  bool refresh(size_t x) {
+    uint64_t old = node[x].load();
+    uint64_t next = ((old & ~LEAF_MASK) + VERSION_ONE) | play(x);
+    return node[x].compare_exchange_strong(old, next);
+  }
+
+  /**
+   * @brief Recompute node x from its children when no other thread can touch it
+   */
+  void settle(size_t x) { node[x].store(((node[x].load() & ~LEAF_MASK) + VERSION_ONE) | play(x)); }
+
+  void build_recursive(size_t x, size_t l, size_t r) {
+    if (l == r) return;
+
+    size_t mid = (l + r) / 2;
+    if (parallel && r - l > granularity) {
+      Scheduler::par_do([&]() { build_recursive(2 * x, l, mid); }, [&]() { build_recursive(2 * x + 1, mid + 1, r); });
+    } else {
+      build_recursive(2 * x, l, mid);
+      build_recursive(2 * x + 1, mid + 1, r);
+    }
+    settle(x);
+  }
+
+  void build() { Scheduler::run(parallel, [&]() { build_recursive(1, 0, leaves - 1); }); }
+
+  // Forget the previous build and size the arrays for count leaves. Atomics cannot be moved, so the flag and node
+  // arrays are only replaced when they are too small; otherwise the flags are cleared and build() settles every node
+  void restart(size_t count, bool arrow_mode, T inf_value, bool _parallel, size_t _granularity) {
+    if (count >= LEAF_MASK) {
+      throw std::invalid_argument("Input array is too large for a tournament tree");
+    }
+    n = count;
+    leaves = leaf_slots(count);
+    infinity = inf_value;
+    prefix_mode = arrow_mode;
+    parallel = _parallel;
+    granularity = _granularity;
+    rounds = 0;
+    arrow_round = nullptr;
+    if (gone.size() < n) {
+      std::vector<std::atomic<uint8_t>>(n).swap(gone);
+    } else {
+      for (size_t i = 0; i < n; ++i) gone[i].store(0);
+    }
+    if (node.size() < leaves) std::vector<std::atomic<uint64_t>>(leaves).swap(node);
+  }
+
+  void prefix_min_recursive(size_t x, size_t l, size_t r, T pre) {
+    Stats::node();
+    T best = key(winner(x));
+    if (best > pre || !(best < infinity)) {
+      return;
+    }
+
+    if (l == r) {
+      const auto ys = arrows.row(l);
+
+      // Check if we need to do binary search or linear search
+      size_t consumed = now[l];
+      if (now[l] + 8 >= ys.size() || static_cast<T>(ys[now[l] + 8]) > pre) {
+        while (now[l] < ys.size() && static_cast<T>(ys[now[l]]) <= pre) {
+          now[l]++;
+        }
+      } else {
+        now[l] = std::upper_bound(ys.begin() + now[l], ys.end(), pre,
+                                  [](const T &v, const arrow_column_t<T> &a) { return v < static_cast<T>(a); }) -
+                 ys.begin();
+      }
+      if (arrow_round) {
+        std::fill(arrow_round->begin() + arrows.offset(l) + consumed,
+                  arrow_round->begin() + arrows.offset(l) + now[l], rounds);
+      }
+      Stats::leaf();
+      Stats::frontier(now[l] - consumed);
+
+      keys[l] = read(l);
+      return;
+    }
+
+    size_t mid = (l + r) / 2;
+    T left_min = key(winner(2 * x));
+
+    // The right subtree only sees the leaves before it through left_min, so it can be skipped whenever the left
+    // subtree holds the strict minimum
+    if (key(winner(2 * x + 1)) <= left_min) {
+      if (left_min <= pre && left_min < infinity) {
+        if (parallel && r - l > granularity) {
+          Stats::spawn();
+          Scheduler::par_do([&]() { prefix_min_recursive(2 * x, l, mid, pre); },
+                            [&]() { prefix_min_recursive(2 * x + 1, mid + 1, r, left_min); });
+        } else {
+          prefix_min_recursive(2 * x, l, mid, pre);
+          prefix_min_recursive(2 * x + 1, mid + 1, r, left_min);
+        }
+      } else {
+        prefix_min_recursive(2 * x + 1, mid + 1, r, pre);
+      }
+    } else {
+      prefix_min_recursive(2 * x, l, mid, pre);
+    }
+
+    settle(x);
+  }
+
+  /**
+   * @brief Apply a sorted batch of leaf changes below node x, settling each affected node once
+   *
+   * @param apply Function applying the change of a batch entry to leaf l, given a pointer to its position
+   */
+  template <typename Apply>
+  void batch_recursive(size_t x, size_t l, size_t r, const size_t *first, const size_t *last, const Apply &apply) {
+    if (first == last) {
+      return;
+    }
+
+    // A repeated position takes the change of its last occurrence
+    if (l == r) {
+      apply(l, last - 1);
+      return;
+    }
+
+    size_t mid = (l + r) / 2;
+    const size_t *split = std::upper_bound(first, last, mid);
+
+    if (parallel && r - l > granularity && first != split && split != last) {
+      Scheduler::par_do([&]() { batch_recursive(2 * x, l, mid, first, split, apply); },
+                        [&]() { batch_recursive(2 * x + 1, mid + 1, r, split, last, apply); });
+    } else {
+      batch_recursive(2 * x, l, mid, first, split, apply);
+      batch_recursive(2 * x + 1, mid + 1, r, split, last, apply);
+    }
+
+    settle(x);
+  }
+
+  size_t extract_frontier_recursive(size_t x, size_t l, size_t r, T pre, int round, std::vector<int> &rank) {
+    Stats::node();
+    T best = key(winner(x));
+    if (best > pre || !(best < infinity)) {
+      return 0;
+    }
+
+    if (l == r) {
+      rank[l] = round;
+      gone[l].store(1);
+      Stats::leaf();
+      Stats::frontier(1);
+      return 1;
+    }
+
+    size_t mid = (l + r) / 2;
+    T left_min = key(winner(2 * x));
+    T right_pre = std::min(pre, left_min);
+    size_t left_removed = 0, right_removed = 0;
+
+    if (parallel && r - l > granularity && left_min <= pre && key(winner(2 * x + 1)) <= right_pre) {
+      Stats::spawn();
+      Scheduler::par_do(
+          [&]() { left_removed = extract_frontier_recursive(2 * x, l, mid, pre, round, rank); },
+          [&]() { right_removed = extract_frontier_recursive(2 * x + 1, mid + 1, r, right_pre, round, rank); });
+    } else {
+      left_removed = extract_frontier_recursive(2 * x, l, mid, pre, round, rank);
+      right_removed = extract_frontier_recursive(2 * x + 1, mid + 1, r, right_pre, round, rank);
+    }
+
+    settle(x);
+    return left_removed + right_removed;
+  }
+
  public:
-  TournamentTree(const std::vector<T> &data, Compare cmp = Compare())
-      : data_(&data), finalized_(new std::vector<bool>(data.size(), false)), cmp_(cmp) {}
+  /**
+   * @brief Construct a new Tournament Tree over an array of keys
+   *
+   * @param arr The keys of the leaves
+   * @param inf_value The value to use as infinity (default: maximum value of type T)
+   * @param _parallel Whether to build and update the tree in parallel
+   * @param _granularity The minimum size of a subtree to process in parallel
+   * @throws std::invalid_argument if the array is empty or has more than 2^32 - 1 entries
+   */
+  TournamentTree(const std::vector<T> &arr, T inf_value = std::numeric_limits<T>::max(), bool _parallel = false,
+                 size_t _granularity = 1000)
+      : n(arr.size()),
+        leaves(leaf_slots(arr.size())),
+        infinity(inf_value),
+        keys(arr),
+        gone(arr.size()),
+        node(leaves),
+        granularity(_granularity),
+        parallel(_parallel) {
+    if (n == 0) {
+      throw std::invalid_argument("Input array cannot be empty");
+    }
+    if (n >= LEAF_MASK) {
+      throw std::invalid_argument("Input array is too large for a tournament tree");
+    }
+    build();
+  }
 
-  // Query the index of the smallest data[i] in the range [start, end) that is not in the finalized state
-  int query(int start, int end) { return 0; }
+  /**
+   * @brief Construct a new Tournament Tree for LCS prefix minimum operation
+   *
+   * @param _arrows The arrow rows in CSR storage, one leaf per row
+   * @param inf_value The value to use as infinity (default: maximum value of type T)
+   * @param _parallel Whether to build and update the tree in parallel
+   * @param _granularity The minimum size of a subtree to process in parallel
+   * @throws std::invalid_argument if there are no rows or more than 2^32 - 1 of them
+   */
+  TournamentTree(ArrowsCSR<arrow_column_t<T>> _arrows, T inf_value = std::numeric_limits<T>::max(),
+                 bool _parallel = false, size_t _granularity = 1000)
+      : n(_arrows.size()),
+        leaves(leaf_slots(_arrows.size())),
+        infinity(inf_value),
+        keys(_arrows.size()),
+        gone(_arrows.size()),
+        node(leaves),
+        prefix_mode(true),
+        now(_arrows.size(), 0),
+        arrows(std::move(_arrows)),
+        granularity(_granularity),
+        parallel(_parallel) {
+    if (n == 0) {
+      throw std::invalid_argument("Arrow sequences cannot be empty");
+    }
+    if (n >= LEAF_MASK) {
+      throw std::invalid_argument("Too many arrow sequences for a tournament tree");
+    }
+    for (size_t i = 0; i < n; ++i) keys[i] = read(i);
+    build();
+  }
 
-  // When the index is finalized, remove the index from the data structure
-  void remove(int index) {}
+  /**
+   * @brief Rebuild the tree over new keys, reusing the node and flag storage of earlier builds
+   *
+   * @throws std::invalid_argument if the array is empty or has more than 2^32 - 1 entries
+   */
+  void reset(const std::vector<T> &arr, T inf_value, bool _parallel, size_t _granularity) override {
+    if (arr.empty()) {
+      throw std::invalid_argument("Input array cannot be empty");
+    }
+    restart(arr.size(), false, inf_value, _parallel, _granularity);
+    keys.assign(arr.begin(), arr.end());
+    build();
+  }
 
- private:
-  const std::vector<T> *data_;
-  const std::vector<bool> *finalized_;
-  Compare cmp_;
+  /**
+   * @brief Rebuild the tree for LCS prefix minimum operation over new arrow rows, see Tree::reset
+   *
+   * @throws std::invalid_argument if there are no rows or more than 2^32 - 1 of them
+   */
+  void reset(ArrowsCSR<arrow_column_t<T>> &_arrows, T inf_value, bool _parallel, size_t _granularity) override {
+    if (_arrows.size() == 0) {
+      throw std::invalid_argument("Arrow sequences cannot be empty");
+    }
+    arrows.swap(_arrows);
+    restart(arrows.size(), true, inf_value, _parallel, _granularity);
+    now.assign(n, 0);
+    keys.resize(n);
+    for (size_t i = 0; i < n; ++i) keys[i] = read(i);
+    build();
+  }
+
+  /**
+   * @brief Get the number of leaves
+   */
+  size_t size() const { return n; }
+
+  /**
+   * Return the current global minimum value in the tree
+   */
+  T global_min() override { return key(winner(1)); }
+
+  /**
+   * @brief Find the index of the global minimum value in the tree, the leftmost one on ties
+   */
+  size_t find_min_index() override { return winner(1); }
+
+  /**
+   * @brief Remove a leaf; safe to call concurrently with other removals and queries
+   *
+   * @param pos Position of the leaf to remove
+   * @throws std::out_of_range if the position is out of bounds
+   */
+  void remove(size_t pos) override {
+    if (pos >= n) {
+      throw std::out_of_range("Position out of bounds: " + std::to_string(pos) + " >= " + std::to_string(n));
+    }
+
+    gone[pos].store(1);
+    for (size_t x = (pos + leaves) / 2; x > 0; x /= 2) {
+      if (!refresh(x)) refresh(x);
+    }
+  }
+
+  /**
+   * @brief Remove a batch of leaves, settling each of the O(k log(n / k)) affected nodes once
+   *
+   * Unlike remove(), this is a whole-tree operation and must not overlap other calls.
+   *
+   * @param positions Positions to remove, sorted ascending
+   * @throws std::invalid_argument if the positions are not sorted
+   * @throws std::out_of_range if a position is out of bounds
+   */
+  void remove_batch(const std::vector<size_t> &positions) override {
+    Tree<T>::check_batch(positions, n);
+    if (positions.empty()) {
+      return;
+    }
+
+    const size_t *first = positions.data();
+    Scheduler::run(parallel, [&]() {
+      batch_recursive(1, 0, leaves - 1, first, first + positions.size(),
+                      [&](size_t l, const size_t *) { gone[l].store(1); });
+    });
+  }
+
+  /**
+   * @brief Set a batch of leaves to new keys, restoring any of them that were removed; see remove_batch
+   *
+   * @param positions Positions to update, sorted ascending
+   * @param values New key of every position, in the same order
+   * @throws std::invalid_argument if the positions are not sorted or the sizes differ
+   * @throws std::out_of_range if a position is out of bounds
+   */
+  void update_batch(const std::vector<size_t> &positions, const std::vector<T> &values) override {
+    if (positions.size() != values.size()) {
+      throw std::invalid_argument("Batch positions and values differ in size");
+    }
+    Tree<T>::check_batch(positions, n);
+    if (positions.empty()) {
+      return;
+    }
+
+    const size_t *first = positions.data();
+    Scheduler::run(parallel, [&]() {
+      batch_recursive(1, 0, leaves - 1, first, first + positions.size(), [&](size_t l, const size_t *it) {
+        keys[l] = values[it - first];
+        gone[l].store(0);
+      });
+    });
+  }
+
+  /**
+   * @brief Perform the prefix minimum operation: advance every leaf past the minimum of the leaves before it
+   *
+   * @throws std::runtime_error if the tree was not built from arrows
+   */
+  void prefix_min() override { prefix_min(infinity); }
+
+  /**
+   * @brief Perform the prefix minimum operation after leaves outside the tree whose minimum was pre, see
+   * Tree::prefix_min
+   *
+   * @throws std::runtime_error if the tree was not built from arrows
+   */
+  void prefix_min(T pre) override {
+    if (!prefix_mode) {
+      throw std::runtime_error("This is not Prefix mode");
+    }
+
+    rounds++;
+    Scheduler::run(parallel, [&]() { prefix_min_recursive(1, 0, leaves - 1, pre); });
+  }
+
+  /**
+   * @brief Start or stop recording the round in which prefix_min consumes every arrow, see SegmentTree::track_rounds
+   */
+  void track_rounds(std::vector<int> *buffer) override {
+    if (!prefix_mode) {
+      throw std::runtime_error("This is not Prefix mode");
+    }
+    if (buffer) {
+      buffer->assign(arrows.nnz(), 0);
+    }
+    arrow_round = buffer;
+  }
+
+  /**
+   * @brief Read the next unconsumed arrow of leaf i, or infinity if all of them are consumed
+   */
+  T read(size_t i) const {
+    if (now[i] >= arrows[i].size()) {
+      return std::numeric_limits<T>::max();
+    }
+    return static_cast<T>(arrows[i][now[i]]);
+  }
+
+  /**
+   * @brief Remove the whole frontier of prefix minima in one pass, see SegmentTree::extract_frontier
+   *
+   * @param round The value written to rank for every removed leaf
+   * @param rank Output array indexed by leaf position
+   * @return The number of leaves removed
+   */
+  size_t extract_frontier(int round, std::vector<int> &rank) override {
+    if (rank.size() < n) {
+      throw std::invalid_argument("Rank array is smaller than the tournament tree");
+    }
+
+    size_t removed = 0;
+    Scheduler::run(parallel,
+                   [&]() { removed = extract_frontier_recursive(1, 0, leaves - 1, infinity, round, rank); });
+    return removed;
+  }
 };
+
+template class TournamentTree<int, OpenMPScheduler>;
+template class TournamentTree<long, OpenMPScheduler>;
+template class TournamentTree<double, OpenMPScheduler>;
+template class TournamentTree<int, SequentialScheduler>;
\ No newline at end of file
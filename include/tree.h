@@ -2,14 +2,49 @@
 
 #include <iostream>
 #include <limits>
+#include <algorithm>
 #include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "arrows.h"
 
 template <typename T>
 class Tree {
  public:
   virtual void prefix_min() = 0;
+  // Run one prefix_min round as if the leaves of the tree followed leaves whose minimum was pre, e.g. the rows held by
+  // the earlier ranks of DistributedLCS; prefix_min() is prefix_min(infinity)
+  virtual void prefix_min(T pre) = 0;
   virtual T global_min() = 0;
   virtual size_t find_min_index() = 0;
   virtual void remove(size_t pos) = 0;
+  // Remove or overwrite many leaves at once; positions must be sorted ascending, and every internal node above them is
+  // recomputed once instead of once per position
+  virtual void remove_batch(const std::vector<size_t> &positions) = 0;
+  virtual void update_batch(const std::vector<size_t> &positions, const std::vector<T> &values) = 0;
+  // In prefix mode, record in (*rounds)[k] the number of the prefix_min call that consumed arrow k, in the order of the
+  // CSR column array; the caller owns the buffer so that length-only runs pay nothing, and nullptr stops recording
+  virtual void track_rounds(std::vector<int> *rounds) = 0;
+  // Remove every leaf not exceeding the minimum of the leaves before it, setting rank[i] = round for each; returns the
+  // number of leaves removed
+  virtual size_t extract_frontier(int round, std::vector<int> &rank) = 0;
+  // Rebuild the tree in place over new keys or new arrow rows, as if freshly constructed with the same arguments, while
+  // keeping the storage of earlier builds so that repeated solves stop allocating once the largest input has been seen.
+  // The arrows are swapped in, handing the previous rows back to the caller to be refilled for the next solve
+  virtual void reset(const std::vector<T> &values, T inf_value, bool parallel, size_t granularity) = 0;
+  virtual void reset(ArrowsCSR<arrow_column_t<T>> &arrows, T inf_value, bool parallel, size_t granularity) = 0;
   virtual ~Tree() {}
+
+ protected:
+  // Throw unless positions is sorted ascending and every position is below n
+  static void check_batch(const std::vector<size_t> &positions, size_t n) {
+    if (!std::is_sorted(positions.begin(), positions.end())) {
+      throw std::invalid_argument("Batch positions must be sorted");
+    }
+    if (!positions.empty() && positions.back() >= n) {
+      throw std::out_of_range("Position out of bounds: " + std::to_string(positions.back()) + " >= " +
+                              std::to_string(n));
+    }
+  }
 };
\ No newline at end of file
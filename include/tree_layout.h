@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @brief Node layouts for the array-backed segment trees.
+ *
+ * A layout maps the children of node x, which covers the leaves [l, r], to their array indices, and tells how many
+ * slots a tree over n leaves needs. The root is always stored at index 0, and the split point of [l, r] is always
+ * (l + r) / 2, so trees differ only in where their nodes live in memory.
+ */
+
+/**
+ * @brief Classic binary heap layout: the children of x are 2x + 1 and 2x + 2, using up to 4n slots
+ */
+struct HeapLayout {
+  static constexpr size_t lc(size_t x, size_t, size_t) { return 2 * x + 1; }
+
+  static constexpr size_t rc(size_t x, size_t, size_t) { return 2 * x + 2; }
+
+  static constexpr size_t capacity(size_t n) { return 4 * n; }
+};
+
+/**
+ * @brief Depth-first (pre-order) layout using exactly 2n - 1 slots
+ *
+ * The left child directly follows its parent and the right child follows the whole left subtree, so every subtree
+ * occupies one contiguous block of the array. Once the recursion reaches a subtree that fits in cache, all of its
+ * remaining work stays there, and the leftmost descents of prefix_min and find_min_index walk forward through
+ * adjacent memory.
+ */
+struct PreorderLayout {
+  static constexpr size_t lc(size_t x, size_t, size_t) { return x + 1; }
+
+  static constexpr size_t rc(size_t x, size_t l, size_t r) { return x + 2 * ((l + r) / 2 - l + 1); }
+
+  static constexpr size_t capacity(size_t n) { return n == 0 ? 0 : 2 * n - 1; }
+};
\ No newline at end of file
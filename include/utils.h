@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <random>
@@ -7,8 +8,11 @@
 #include <unordered_map>
 #include <vector>
 
-// enum including CILK and OpenMP
-enum class ParallelArch { CILK, OPENMP, PARLAY, CILK_OPT, NONE };
+#include "arrow_io.h"
+
+// enum including CILK and OpenMP. BIT_PARALLEL solves LCS over the sequences without arrows (see BitParallelLCS), and
+// AUTO lets LCS::compute choose between BIT_PARALLEL and PARLAY by the density of the arrows
+enum class ParallelArch { CILK, OPENMP, PARLAY, CILK_OPT, NONE, TOURNAMENT, BIT_PARALLEL, AUTO, GPU };
 
 template <typename T1, typename T2>
 std::ostream &operator<<(std::ostream &os, const std::pair<T1, T2> &p) {
@@ -24,34 +28,37 @@ struct Interval {
   int j;
 };
 
+// B must be sorted by l with disjoint intervals, as produced by the GLWS solvers
 inline int findBest(int i, const std::vector<Interval> &B) {
-  for (const auto &interval : B) {
-    if (i >= interval.l && i <= interval.r) return interval.j;
-  }
+  auto it =
+      std::upper_bound(B.begin(), B.end(), i, [](int state, const Interval &interval) { return state < interval.l; });
+  if (it != B.begin() && i <= (it - 1)->r) return (it - 1)->j;
   return 0;  // fallback
 }
 
-void get_existing_arrows(int n, int m, int lcs_length, std::vector<std::vector<int>> &arrows) {
-  std::string filename =
-      "arrow_" + std::to_string(n) + "_" + std::to_string(m) + "_" + std::to_string(lcs_length) + ".txt";
-  std::ifstream file(filename);
-  if (file.is_open()) {
-    arrows.clear();
-    arrows.resize(n);
-    std::string line;
-    int i = 0;
-    while (std::getline(file, line) && i < n) {
-      std::istringstream iss(line);
-      int value;
-      while (iss >> value) {
-        arrows[i].push_back(value);
-      }
-      i++;
+// Name of the cached arrows of an LCS instance, a binary arrow file (see arrow_io.h)
+inline std::string arrow_cache_path(int n, int m, int lcs_length) {
+  return "arrow_" + std::to_string(n) + "_" + std::to_string(m) + "_" + std::to_string(lcs_length) + ".bin";
+}
+
+// Read the cached arrows of an instance into arrows; returns false, leaving arrows untouched, if there is no valid
+// cache. Solvers that take ArrowsCSR can use load_arrows(arrow_cache_path(...)) directly and skip the copy.
+bool get_existing_arrows(int n, int m, int lcs_length, std::vector<std::vector<int>> &arrows) {
+  std::string filename = arrow_cache_path(n, m, lcs_length);
+  try {
+    ArrowsCSR<> cached = load_arrows(filename);
+    if (cached.size() != static_cast<size_t>(n)) throw std::runtime_error(filename + " has another number of rows");
+    arrows.assign(n, std::vector<int>());
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < n; i++) {
+      arrows[i].assign(cached.row(i).begin(), cached.row(i).end());
     }
     std::cout << "Arrows read from " << filename << std::endl;
-    return;
+    return true;
+  } catch (const std::runtime_error &e) {
+    std::cout << "Arrows not found in " << filename << " (" << e.what() << ")" << std::endl;
+    return false;
   }
-  std::cout << "Arrows not found in " << filename << std::endl;
 }
 
 template <typename T>
@@ -60,16 +67,8 @@ void get_arrows(const std::vector<T> &data1, const std::vector<T> &data2, int lc
   int n = data1.size();
   int m = data2.size();
 
-  // check if arrow_n_m_lcslen.txt exists
-  std::string filename =
-      "arrow_" + std::to_string(n) + "_" + std::to_string(m) + "_" + std::to_string(lcs_length) + ".txt";
-  std::ifstream file(filename);
-  // if exists, read from file
-  if (file.is_open()) {
-    // read into arrows
-    get_existing_arrows(n, m, lcs_length, arrows);
-    return;
-  }
+  // if arrow_n_m_lcslen.bin exists, read from file
+  if (get_existing_arrows(n, m, lcs_length, arrows)) return;
 
   arrows = std::vector<std::vector<int>>(n, std::vector<int>(0));
 
@@ -89,61 +88,26 @@ void get_arrows(const std::vector<T> &data1, const std::vector<T> &data2, int lc
   }
 
   // save to file
-  std::ofstream outFile(filename);
-  if (outFile.is_open()) {
-    for (int i = 0; i < n; i++) {
-      for (int j : arrows[i]) {
-        outFile << j << " ";
-      }
-      outFile << "\n";
-    }
-    outFile.close();
+  std::string filename = arrow_cache_path(n, m, lcs_length);
+  try {
+    save_arrows(filename, ArrowsCSR<>::from_nested(arrows));
     std::cout << "Arrows saved to " << filename << std::endl;
+  } catch (const std::runtime_error &e) {
+    std::cout << e.what() << std::endl;
   }
 }
 
-void generateLCS(int length1, int length2, int lcsLength, std::vector<std::vector<int>> &arrows) {
-  if (lcsLength > std::min(length1, length2)) {
-    std::cerr << "Error: LCS length cannot be greater than the minimum of the two array lengths" << std::endl;
-    exit(1);
-  }
-
-  // Find if data file exists
-
-  std::string arrow_filename =
-      "arrow_" + std::to_string(length1) + "_" + std::to_string(length2) + "_" + std::to_string(lcsLength) + ".txt";
-  std::ifstream arrow_file(arrow_filename);
-  if (arrow_file.is_open()) {
-    std::cout << "Arrows read from " << arrow_filename << std::endl;
-    get_existing_arrows(length1, length2, lcsLength, arrows);
-    return;
-  }
-
+/**
+ * @brief Generate two sequences whose LCS has length lcsLength: the common values are planted at random positions and
+ * every other element is unique to its sequence, so the arrows are sparse
+ *
+ * @param seed Seed of the generator, so that benchmarks can reproduce their inputs
+ */
+inline std::pair<std::vector<int>, std::vector<int>> generateLCSSequences(int length1, int length2, int lcsLength,
+                                                                          unsigned int seed) {
   std::vector<int> seq1(length1, -1);
   std::vector<int> seq2(length2, -1);
-  // if (file.is_open()) {
-  //     std::string line, temp;
-  //     std::getline(file, line);
-  //     std::istringstream iss1(line.substr(line.find(":") + 1));
-  //     seq1.clear();
-  //     while (iss1 >> temp) {
-  //         seq1.push_back(std::stoi(temp));
-  //     }
-
-  //     std::getline(file, line);
-  //     std::istringstream iss2(line.substr(line.find(":") + 1));
-  //     seq2.clear();
-  //     while (iss2 >> temp) {
-  //         seq2.push_back(std::stoi(temp));
-  //     }
-
-  //     file.close();
-  //     return {seq1, seq2};
-  // }
-
-  // set random seed
-  std::random_device rd;
-  std::mt19937 gen(rd());
+  std::mt19937 gen(seed);
 
   std::vector<int> lcsValues(lcsLength);
   for (int i = 0; i < lcsLength; i++) {
@@ -185,34 +149,32 @@ void generateLCS(int length1, int length2, int lcsLength, std::vector<std::vecto
       seq2[i] = uniqueDist2(gen);
     }
   }
+  return {std::move(seq1), std::move(seq2)};
+}
+
+void generateLCS(int length1, int length2, int lcsLength, std::vector<std::vector<int>> &arrows) {
+  if (lcsLength > std::min(length1, length2)) {
+    std::cerr << "Error: LCS length cannot be greater than the minimum of the two array lengths" << std::endl;
+    exit(1);
+  }
 
-  // // Save results
-  // std::ofstream outFile("lcs_data_" + std::to_string(length1) + "_" + std::to_string(length2) + "_" +
-  // std::to_string(lcsLength) + ".txt"); if (outFile.is_open()) {
-  //     outFile << "Sequence 1: ";
-  //     for (int i = 0; i < length1; i++) {
-  //         outFile << seq1[i] << " ";
-  //     }
-  //     outFile << "\nSequence 2: ";
-  //     for (int i = 0; i < length2; i++) {
-  //         outFile << seq2[i] << " ";
-  //     }
-  //     outFile.close();
-  // }
-
-  // return {seq1, seq2};
+  // Find if data file exists
+  if (get_existing_arrows(length1, length2, lcsLength, arrows)) return;
+
+  auto [seq1, seq2] = generateLCSSequences(length1, length2, lcsLength, std::random_device{}());
   get_arrows(seq1, seq2, lcsLength, arrows);
 }
 
-std::vector<int> generateLIS(int length, int lisLength) {
+/**
+ * @brief Generate a sequence whose LIS has length lisLength, from a random seed unless one is given
+ */
+std::vector<int> generateLIS(int length, int lisLength, unsigned int seed = std::random_device{}()) {
   if (lisLength > length) {
     std::cerr << "Error: LIS length cannot be greater than the minimum of the array lengths" << std::endl;
     exit(1);
   }
 
-  // set random seed
-  std::random_device rd;
-  std::mt19937 gen(rd());
+  std::mt19937 gen(seed);
 
   std::vector<int> lisPositions;
   for (int i = 0; i < lisLength; i++) {
@@ -266,6 +228,46 @@ std::vector<int> generateLIS(int length, int lisLength) {
   return seq;
 }
 
+/**
+ * @brief Sequential patience-sorting LIS in O(n log k), the baseline for the parallel LIS solvers
+ */
+template <typename T, typename Compare = std::less<T>>
+int lis_patience(const std::vector<T> &data, Compare cmp = Compare()) {
+  // tails[k] is the smallest tail of an increasing subsequence of length k + 1
+  std::vector<T> tails;
+  for (const auto &x : data) {
+    auto it = std::lower_bound(tails.begin(), tails.end(), x, cmp);
+    if (it == tails.end()) {
+      tails.push_back(x);
+    } else {
+      *it = x;
+    }
+  }
+  return tails.size();
+}
+
+/**
+ * @brief Sequential weighted LIS in O(n log n) with a Fenwick tree of prefix maxima over the ranks of the values, the
+ * baseline for LIS::compute_weighted
+ */
+template <typename T, typename W, typename Compare = std::less<T>>
+W lis_weighted_fenwick(const std::vector<T> &data, const std::vector<W> &weights, Compare cmp = Compare()) {
+  std::vector<T> values = data;
+  std::sort(values.begin(), values.end(), cmp);
+  std::vector<W> fenwick(values.size() + 1, W());
+  W best = W();
+  for (size_t i = 0; i < data.size(); ++i) {
+    // Ranks below rank hold the values less than data[i]
+    size_t rank = std::lower_bound(values.begin(), values.end(), data[i], cmp) - values.begin();
+    W value = W();
+    for (size_t k = rank; k > 0; k -= k & -k) value = std::max(value, fenwick[k]);
+    value += weights[i];
+    for (size_t k = rank + 1; k <= values.size(); k += k & -k) fenwick[k] = std::max(fenwick[k], value);
+    best = i == 0 ? value : std::max(best, value);
+  }
+  return best;
+}
+
 template <typename T>
 int lcs_dp_naive(const std::vector<T> &seq1, const std::vector<T> &seq2) {
   int m = seq1.size();
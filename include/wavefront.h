@@ -0,0 +1,226 @@
+#pragma once
+
+#include <omp.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Generic parallel executor for recurrences over a box of integer states.
+ *
+ * Every dependency of the recurrence is described by the range of offsets, per dimension, from a state to the states
+ * it reads. The engine looks for a schedule vector s in {-1, 0, 1}^d with s * offset < 0 for every such offset, so that
+ * the states of one level s * x only read states of earlier levels, and runs each level as one parallel loop. Vectors
+ * with fewer non-zero entries are preferred since they give fewer, wider levels (e.g. whole rows for knapsack-like
+ * recurrences, diagonals for interval DP).
+ *
+ * Two-dimensional recurrences whose offsets are all non-positive in both dimensions (LCS-like) run as a wavefront of
+ * square tiles instead: every tile only reads tiles above and to the left of it, and is evaluated row by row, which
+ * keeps the rows it reads in cache.
+ */
+class Wavefront {
+ public:
+  static constexpr double UNBOUNDED = std::numeric_limits<double>::infinity();
+
+  /**
+   * @brief The offsets [lo[d], hi[d]] from a state to the states it reads, either end possibly UNBOUNDED
+   */
+  struct Dependency {
+    std::vector<double> lo;
+    std::vector<double> hi;
+  };
+
+  enum class Strategy { LEVELS, TILES };
+
+  /**
+   * @param lower The lowest index of every dimension
+   * @param upper The highest index of every dimension (inclusive)
+   * @param dependencies The dependencies of the recurrence
+   * @param tile The side of a tile for Strategy::TILES
+   * @throws std::invalid_argument if the inputs disagree on the number of dimensions
+   * @throws std::runtime_error if no schedule vector satisfies the dependencies
+   */
+  Wavefront(std::vector<int> lower, std::vector<int> upper, const std::vector<Dependency> &dependencies,
+            int tile = 64)
+      : lower(std::move(lower)), upper(std::move(upper)), tile(std::max(tile, 1)) {
+    size_t d = this->lower.size();
+    if (this->upper.size() != d) throw std::invalid_argument("Bounds have different dimensions");
+    for (const auto &dep : dependencies) {
+      if (dep.lo.size() != d || dep.hi.size() != d) throw std::invalid_argument("Dependency has the wrong dimension");
+    }
+
+    extent.resize(d);
+    stride.assign(d, 1);
+    states = 1;
+    for (size_t k = d; k-- > 0;) {
+      extent[k] = std::max(this->upper[k] - this->lower[k] + 1, 0);
+      stride[k] = states;
+      states *= static_cast<size_t>(extent[k]);
+    }
+
+    if (!find_schedule(dependencies)) {
+      throw std::runtime_error("No wavefront order satisfies the dependencies");
+    }
+
+    bool non_positive = true;
+    for (const auto &dep : dependencies) {
+      for (double hi : dep.hi) non_positive = non_positive && hi <= 0;
+    }
+    order = d == 2 && s == std::vector<int>{1, 1} && non_positive ? Strategy::TILES : Strategy::LEVELS;
+  }
+
+  /**
+   * @brief Get the number of states
+   */
+  size_t size() const { return states; }
+
+  /**
+   * @brief Get the row-major index of a state
+   */
+  size_t index(const std::vector<int> &point) const {
+    size_t idx = 0;
+    for (size_t k = 0; k < point.size(); ++k) idx += static_cast<size_t>(point[k] - lower[k]) * stride[k];
+    return idx;
+  }
+
+  /**
+   * @brief Check whether a point lies inside the box of states
+   */
+  bool contains(const std::vector<int> &point) const {
+    for (size_t k = 0; k < point.size(); ++k) {
+      if (point[k] < lower[k] || point[k] > upper[k]) return false;
+    }
+    return true;
+  }
+
+  const std::vector<int> &schedule() const { return s; }
+
+  Strategy strategy() const { return order; }
+
+  /**
+   * @brief Call f(point, index) once for every state, after the calls of all states it depends on have returned
+   *
+   * @param f Invoked concurrently for independent states; it must only write the state it is called for
+   * @param parallel Whether independent states are processed in parallel
+   */
+  template <typename F>
+  void run(F &&f, bool parallel = true) const {
+    if (states == 0) return;
+    if (order == Strategy::TILES) {
+      run_tiles(f, parallel);
+    } else {
+      run_levels(f, parallel);
+    }
+  }
+
+ private:
+  std::vector<int> lower;
+  std::vector<int> upper;
+  std::vector<int> extent;
+  std::vector<size_t> stride;
+  size_t states;
+  int tile;
+  std::vector<int> s;
+  Strategy order;
+
+  // Largest s * offset over a dependency; the schedule is valid when it is negative for all of them
+  static double latest(const std::vector<int> &s, const Dependency &dep) {
+    double sum = 0;
+    for (size_t k = 0; k < s.size(); ++k) {
+      if (s[k] > 0) sum += dep.hi[k];
+      if (s[k] < 0) sum -= dep.lo[k];
+    }
+    return sum;
+  }
+
+  bool find_schedule(const std::vector<Dependency> &dependencies) {
+    size_t d = lower.size();
+    std::vector<std::vector<int>> candidates;
+    std::vector<int> v(d, -1);
+    while (true) {
+      candidates.push_back(v);
+      size_t k = d;
+      while (k > 0 && v[k - 1] == 1) v[--k] = -1;
+      if (k == 0) break;
+      v[k - 1]++;
+    }
+    // The zero vector is only valid without dependencies; then fewer non-zeros first, positive entries first
+    auto nonzeros = [](const std::vector<int> &c) {
+      return std::count_if(c.begin(), c.end(), [](int x) { return x != 0; });
+    };
+    std::stable_sort(candidates.begin(), candidates.end(), [&](const std::vector<int> &a, const std::vector<int> &b) {
+      if (nonzeros(a) != nonzeros(b)) return nonzeros(a) < nonzeros(b);
+      return a > b;
+    });
+
+    for (const auto &c : candidates) {
+      bool valid = std::all_of(dependencies.begin(), dependencies.end(),
+                               [&](const Dependency &dep) { return latest(c, dep) < 0; });
+      if (valid) {
+        s = c;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  template <typename F>
+  void run_levels(F &f, bool parallel) const {
+    size_t d = lower.size();
+    // level(x) = s * (x - lower) - base, shifted to start at 0
+    int base = 0, levels = 1;
+    for (size_t k = 0; k < d; ++k) {
+      if (s[k] < 0) base -= extent[k] - 1;
+      levels += std::abs(s[k]) * (extent[k] - 1);
+    }
+
+    std::vector<int> level(states);
+    std::vector<size_t> start(levels + 1, 0);
+    for (size_t idx = 0; idx < states; ++idx) {
+      int l = -base;
+      for (size_t k = 0; k < d; ++k) l += s[k] * static_cast<int>(idx / stride[k] % extent[k]);
+      level[idx] = l;
+      start[l + 1]++;
+    }
+    for (int l = 0; l < levels; ++l) start[l + 1] += start[l];
+    std::vector<size_t> members(states);
+    std::vector<size_t> fill(start.begin(), start.end() - 1);
+    for (size_t idx = 0; idx < states; ++idx) members[fill[level[idx]]++] = idx;
+
+    for (int l = 0; l < levels; ++l) {
+      long long first = start[l], last = start[l + 1];
+#pragma omp parallel for schedule(dynamic, 16) if (parallel && last - first > 1)
+      for (long long m = first; m < last; ++m) {
+        size_t idx = members[m];
+        std::vector<int> point(d);
+        for (size_t k = 0; k < d; ++k) point[k] = lower[k] + static_cast<int>(idx / stride[k] % extent[k]);
+        f(point, idx);
+      }
+    }
+  }
+
+  template <typename F>
+  void run_tiles(F &f, bool parallel) const {
+    int rows = (extent[0] + tile - 1) / tile;
+    int cols = (extent[1] + tile - 1) / tile;
+    for (int t = 0; t < rows + cols - 1; ++t) {
+      int first = std::max(0, t - cols + 1), last = std::min(rows - 1, t);
+#pragma omp parallel for schedule(dynamic, 1) if (parallel && last > first)
+      for (int ti = first; ti <= last; ++ti) {
+        int tj = t - ti;
+        std::vector<int> point(2);
+        for (int i = ti * tile; i < std::min(extent[0], (ti + 1) * tile); ++i) {
+          for (int j = tj * tile; j < std::min(extent[1], (tj + 1) * tile); ++j) {
+            point[0] = lower[0] + i;
+            point[1] = lower[1] + j;
+            f(point, static_cast<size_t>(i) * stride[0] + j);
+          }
+        }
+      }
+    }
+  }
+};
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cuda_runtime.h>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "gpu.h"
+
+// Turn a failed CUDA call into std::runtime_error, the error every GPU entry point reports
+#define CUDA_CHECK(call)                                                                                       \
+  do {                                                                                                         \
+    cudaError_t status = (call);                                                                               \
+    if (status != cudaSuccess) throw std::runtime_error(std::string(#call) + ": " + cudaGetErrorString(status)); \
+  } while (0)
+
+namespace Gpu {
+
+constexpr int BLOCK = 256;
+
+inline unsigned blocks(size_t threads) { return static_cast<unsigned>((threads + BLOCK - 1) / BLOCK); }
+
+/**
+ * @brief Device array that keeps its allocation when shrunk, so that solves of smaller inputs reuse it
+ */
+template <typename T>
+class DeviceBuffer {
+ private:
+  T *ptr = nullptr;
+  size_t capacity = 0;
+
+ public:
+  DeviceBuffer() = default;
+  ~DeviceBuffer() { cudaFree(ptr); }
+  DeviceBuffer(const DeviceBuffer &) = delete;
+  DeviceBuffer &operator=(const DeviceBuffer &) = delete;
+
+  // Grow to hold n elements; the contents are not kept
+  void reserve(size_t n) {
+    if (n <= capacity) return;
+    CUDA_CHECK(cudaFree(ptr));
+    ptr = nullptr;
+    CUDA_CHECK(cudaMalloc(&ptr, n * sizeof(T)));
+    capacity = n;
+  }
+
+  void upload(const T *host, size_t n) {
+    reserve(n);
+    if (n > 0) CUDA_CHECK(cudaMemcpy(ptr, host, n * sizeof(T), cudaMemcpyHostToDevice));
+  }
+
+  T read(size_t i) const {
+    T value;
+    CUDA_CHECK(cudaMemcpy(&value, ptr + i, sizeof(T), cudaMemcpyDeviceToHost));
+    return value;
+  }
+
+  void swap(DeviceBuffer &other) {
+    std::swap(ptr, other.ptr);
+    std::swap(capacity, other.capacity);
+  }
+
+  T *data() const { return ptr; }
+};
+
+}  // namespace Gpu
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <limits>
+
+#include "cuda_check.cuh"
+
+namespace Gpu {
+
+namespace {
+
+constexpr int WARP = 32;
+
+// A subproblem of findIntervals: the best decisions of the states [il, ir] among the candidates [jl, jr]
+struct Node {
+  int il, ir, jl, jr;
+};
+
+// PostOfficeCost::operator() on device arrays, in the same order of operations
+template <typename T>
+struct PostOffice {
+  const T *pos;
+  const T *prefix;
+  T build;
+
+  __device__ T operator()(int j, int i) const {
+    if (i - j < 1) return build;
+    int mid = j + 1 + (i - j - 1) / 2;
+    T median = pos[mid];
+    T left = median * (mid - j) - (prefix[mid] - prefix[j]);
+    T right = (prefix[i] - prefix[mid]) - median * (i - mid);
+    return left + right + build;
+  }
+};
+
+template <typename T>
+__global__ void start_values(int n, T inf, T *D) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i <= n) D[i] = i == 0 ? T() : inf;
+}
+
+// One doubling stage of findCordon over the candidates [l, r]; the grid strides over them in order, so a thread stops
+// at its first candidate behind the cordon and a stage that starts behind it costs one read per thread
+template <typename T>
+__global__ void relax_stage(int l, int r, int n, PostOffice<T> cost, const T *D, const int *best, int *cordon) {
+  const volatile int *current = cordon;
+  for (int j = l + blockIdx.x * blockDim.x + threadIdx.x; j <= r; j += gridDim.x * blockDim.x) {
+    if (j + 1 >= *current) return;
+    int bestj = best[j];
+    T Dj = D[bestj] + cost(bestj, j);
+    if (!(Dj < D[j])) continue;
+    // Binary search for the first state in [j + 1, hi] that j improves, see ConvexGLWS::firstImproved
+    auto improves = [&](int i) {
+      int b = best[i];
+      return Dj + cost(j, i) < D[b] + cost(b, i);
+    };
+    int lo = j + 1, hi = min(n, *current - 1);
+    if (lo > hi || !improves(hi)) continue;
+    while (lo < hi) {
+      int mid = lo + (hi - lo) / 2;
+      if (improves(mid)) {
+        hi = mid;
+      } else {
+        lo = mid + 1;
+      }
+    }
+    atomicMin(cordon, lo);
+  }
+}
+
+template <typename T>
+__global__ void finalize(int now, int cordon, PostOffice<T> cost, T *D, const int *best) {
+  int i = now + 1 + blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < cordon) D[i] = D[best[i]] + cost(best[i], i);
+}
+
+// One level of findIntervals, a warp per node; ties go to the smallest candidate, as in the host scan
+template <typename T>
+__global__ void assign_level(int count, const Node *nodes, Node *children, PostOffice<T> cost, const T *D, int *best) {
+  int w = (blockIdx.x * blockDim.x + threadIdx.x) / WARP, lane = threadIdx.x % WARP;
+  if (w >= count) return;
+  Node node = nodes[w];
+  if (node.il > node.ir) {
+    if (lane == 0) children[2 * w] = children[2 * w + 1] = node;
+    return;
+  }
+  int im = (node.il + node.ir) / 2, arg = -1;
+  T val = T();
+  for (int j = node.jl + lane; j <= node.jr; j += WARP) {
+    T candidate = D[j] + cost(j, im);
+    if (arg < 0 || candidate < val) {
+      val = candidate;
+      arg = j;
+    }
+  }
+  for (int offset = WARP / 2; offset > 0; offset /= 2) {
+    T other_val = __shfl_down_sync(0xffffffffu, val, offset);
+    int other_arg = __shfl_down_sync(0xffffffffu, arg, offset);
+    if (other_arg >= 0 && (arg < 0 || other_val < val || (other_val == val && other_arg < arg))) {
+      val = other_val;
+      arg = other_arg;
+    }
+  }
+  if (lane == 0) {
+    best[im] = arg;
+    children[2 * w] = Node{node.il, im - 1, node.jl, arg};
+    children[2 * w + 1] = Node{im + 1, node.ir, arg, node.jr};
+  }
+}
+
+}  // namespace
+
+template <typename T>
+struct PostOfficeGLWS<T>::Device {
+  DeviceBuffer<T> pos;
+  DeviceBuffer<T> prefix;
+  DeviceBuffer<T> D;
+  DeviceBuffer<int> best;    // best[i]: best decision of state i among the finalized states, the flat form of B
+  DeviceBuffer<int> cordon;  // Cordon of the round, lowered by relax_stage
+  DeviceBuffer<Node> level;  // Nodes of the current level of assign_level
+  DeviceBuffer<Node> next;   // and of the next one
+  T build = T();             // Cost of opening a segment
+  int max_grid = 0;          // Largest grid of relax_stage, a few blocks per multiprocessor
+
+  PostOffice<T> cost() const { return PostOffice<T>{pos.data(), prefix.data(), build}; }
+};
+
+template <typename T>
+PostOfficeGLWS<T>::PostOfficeGLWS() : device(std::make_unique<Device>()) {
+  int deviceId = 0, multiprocessors = 0;
+  CUDA_CHECK(cudaGetDevice(&deviceId));
+  CUDA_CHECK(cudaDeviceGetAttribute(&multiprocessors, cudaDevAttrMultiProcessorCount, deviceId));
+  device->max_grid = 4 * multiprocessors;
+}
+
+template <typename T>
+PostOfficeGLWS<T>::~PostOfficeGLWS() = default;
+
+template <typename T>
+void PostOfficeGLWS<T>::reset(const std::vector<T> &pos, const std::vector<T> &prefix, T build_cost) {
+  Device &d = *device;
+  n = static_cast<int>(pos.size()) - 1;
+  d.build = build_cost;
+  d.pos.upload(pos.data(), n + 1);
+  d.prefix.upload(prefix.data(), n + 1);
+  d.D.reserve(n + 1);
+  d.best.reserve(n + 1);
+  d.cordon.reserve(1);
+  // A level of assign_level holds up to twice as many nodes as states
+  d.level.reserve(2 * (n + 1));
+  d.next.reserve(2 * (n + 1));
+  start_values<<<blocks(n + 1), BLOCK>>>(n, std::numeric_limits<T>::max(), d.D.data());
+  CUDA_CHECK(cudaGetLastError());
+  CUDA_CHECK(cudaMemset(d.best.data(), 0, (n + 1) * sizeof(int)));
+}
+
+template <typename T>
+int PostOfficeGLWS<T>::round(int now) {
+  Device &d = *device;
+  int cordon = n + 1;
+  CUDA_CHECK(cudaMemcpy(d.cordon.data(), &cordon, sizeof(int), cudaMemcpyHostToDevice));
+  for (int t = 1; (now + (1 << t)) <= n; ++t) {
+    int l = now + (1 << (t - 1)), r = std::min(n, now + (1 << t) - 1);
+    unsigned grid = std::min(blocks(r - l + 1), static_cast<unsigned>(d.max_grid));
+    relax_stage<<<grid, BLOCK>>>(l, r, n, d.cost(), d.D.data(), d.best.data(), d.cordon.data());
+  }
+  CUDA_CHECK(cudaGetLastError());
+  cordon = d.cordon.read(0);
+
+  if (cordon - 1 > now) {
+    finalize<<<blocks(cordon - 1 - now), BLOCK>>>(now, cordon, d.cost(), d.D.data(), d.best.data());
+    CUDA_CHECK(cudaGetLastError());
+  }
+  if (cordon > n) return cordon;
+
+  // Reassign the decisions of [cordon, n] among the candidates [now + 1, cordon - 1]
+  Node root{cordon, n, now + 1, cordon - 1};
+  CUDA_CHECK(cudaMemcpy(d.level.data(), &root, sizeof(Node), cudaMemcpyHostToDevice));
+  for (int count = 1, states = n - cordon + 1; states > 0; count *= 2, states /= 2) {
+    assign_level<<<blocks(static_cast<size_t>(count) * WARP), BLOCK>>>(count, d.level.data(), d.next.data(), d.cost(),
+                                                                      d.D.data(), d.best.data());
+    CUDA_CHECK(cudaGetLastError());
+    d.level.swap(d.next);
+  }
+  return cordon;
+}
+
+template <typename T>
+void PostOfficeGLWS<T>::download(std::vector<T> &D, std::vector<int> &decisions) {
+  D.resize(n + 1);
+  decisions.resize(n + 1);
+  CUDA_CHECK(cudaMemcpy(D.data(), device->D.data(), (n + 1) * sizeof(T), cudaMemcpyDeviceToHost));
+  CUDA_CHECK(cudaMemcpy(decisions.data(), device->best.data(), (n + 1) * sizeof(int), cudaMemcpyDeviceToHost));
+}
+
+template class PostOfficeGLWS<int>;
+template class PostOfficeGLWS<long long>;
+template class PostOfficeGLWS<double>;
+
+}  // namespace Gpu
@@ -0,0 +1,109 @@
+#include <cub/cub.cuh>
+#include <algorithm>
+#include <limits>
+
+#include "cuda_check.cuh"
+
+namespace Gpu {
+
+namespace {
+
+constexpr uint32_t INF = std::numeric_limits<uint32_t>::max();
+
+struct MinOp {
+  __device__ uint32_t operator()(uint32_t a, uint32_t b) const { return a < b ? a : b; }
+};
+
+__global__ void start_leaves(size_t n, const size_t *offsets, const uint32_t *columns, size_t *cursor, uint32_t *head) {
+  size_t i = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x;
+  if (i >= n) return;
+  cursor[i] = offsets[i];
+  head[i] = offsets[i] < offsets[i + 1] ? columns[offsets[i]] : INF;
+}
+
+// A leaf whose head is at most the minimum of the heads before it moves its cursor past the columns <= that minimum
+__global__ void advance_leaves(size_t n, const size_t *offsets, const uint32_t *columns, const uint32_t *pre,
+                               size_t *cursor, uint32_t *head) {
+  size_t i = blockIdx.x * static_cast<size_t>(blockDim.x) + threadIdx.x;
+  if (i >= n) return;
+  uint32_t bound = pre[i];
+  if (head[i] == INF || head[i] > bound) return;
+  size_t lo = cursor[i] + 1, hi = offsets[i + 1];
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (columns[mid] <= bound) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  cursor[i] = lo;
+  head[i] = lo < offsets[i + 1] ? columns[lo] : INF;
+}
+
+}  // namespace
+
+struct LCSRounds::Device {
+  int n = 0;
+  DeviceBuffer<size_t> offsets;
+  DeviceBuffer<uint32_t> columns;
+  DeviceBuffer<size_t> cursor;          // cursor[i]: first arrow of row i not consumed yet
+  DeviceBuffer<uint32_t> head;          // head[i]: column at the cursor of row i, INF once the row is consumed
+  DeviceBuffer<uint32_t> pre;           // pre[i]: minimum of the heads before row i at the start of the round
+  DeviceBuffer<uint32_t> minimum;       // Minimum of all heads, the flag read back by pending()
+  DeviceBuffer<unsigned char> scratch;  // Temporary storage of the CUB scan and reduction
+  size_t scratch_bytes = 0;
+
+  void reduce() {
+    size_t bytes = scratch_bytes;
+    CUDA_CHECK(cub::DeviceReduce::Reduce(scratch.data(), bytes, head.data(), minimum.data(), n, MinOp(), INF));
+  }
+};
+
+int device_count() {
+  int count = 0;
+  if (cudaGetDeviceCount(&count) != cudaSuccess) return 0;
+  return count;
+}
+
+LCSRounds::LCSRounds() : device(std::make_unique<Device>()) {}
+
+LCSRounds::~LCSRounds() = default;
+
+void LCSRounds::reset(size_t n, const size_t *offsets, const uint32_t *columns) {
+  Device &d = *device;
+  d.n = static_cast<int>(n);
+  if (n == 0) return;
+  d.offsets.upload(offsets, n + 1);
+  d.columns.upload(columns, offsets[n]);
+  d.cursor.reserve(n);
+  d.head.reserve(n);
+  d.pre.reserve(n);
+  d.minimum.reserve(1);
+
+  size_t scan_bytes = 0, reduce_bytes = 0;
+  CUDA_CHECK(cub::DeviceScan::ExclusiveScan(nullptr, scan_bytes, d.head.data(), d.pre.data(), MinOp(), INF, d.n));
+  CUDA_CHECK(
+      cub::DeviceReduce::Reduce(nullptr, reduce_bytes, d.head.data(), d.minimum.data(), d.n, MinOp(), INF));
+  d.scratch_bytes = std::max(scan_bytes, reduce_bytes);
+  d.scratch.reserve(d.scratch_bytes);
+
+  start_leaves<<<blocks(n), BLOCK>>>(n, d.offsets.data(), d.columns.data(), d.cursor.data(), d.head.data());
+  CUDA_CHECK(cudaGetLastError());
+  d.reduce();
+}
+
+bool LCSRounds::pending() { return device->n > 0 && device->minimum.read(0) != INF; }
+
+void LCSRounds::prefix_min() {
+  Device &d = *device;
+  size_t bytes = d.scratch_bytes;
+  CUDA_CHECK(
+      cub::DeviceScan::ExclusiveScan(d.scratch.data(), bytes, d.head.data(), d.pre.data(), MinOp(), INF, d.n));
+  advance_leaves<<<blocks(d.n), BLOCK>>>(d.n, d.offsets.data(), d.columns.data(), d.pre.data(), d.cursor.data(),
+                                         d.head.data());
+  CUDA_CHECK(cudaGetLastError());
+  d.reduce();
+}
+
+}  // namespace Gpu
@@ -1,15 +1,21 @@
 #include "dsl.h"
+#include "dsl_static.h"
+#include <climits>
 #include <iostream>
+#include <numeric>
 #include <vector>
 
 using namespace dp_dsl;
+namespace ct = dp_dsl::ct;
 
 void detectProblemType(DPProblem<int> &problem) {
     ProblemType type = problem.getProblemType();
     std::cout << "Detected problem type: " << 
         (type == ProblemType::LIS ? "LIS" : 
          type == ProblemType::LCS ? "LCS" : 
-         type == ProblemType::CONVEX_GLWS ? "Convex GLWS" : "Unknown") 
+         type == ProblemType::CONVEX_GLWS ? "Convex GLWS" :
+         type == ProblemType::GLWS ? "GLWS" :
+         type == ProblemType::WEIGHTED_LIS ? "Weighted LIS" : "Unknown (generic wavefront)") 
         << std::endl;
 }
 
@@ -19,7 +25,7 @@ int main() {
     std::cout << "Example 1: LIS" << std::endl;
     auto Seq = new Sequence<int>({3, 1, 4, 2, 7, 5, 8, 6, 9, 10});
     auto I = new IndVar(0, 10);
-    auto J = new RangeDepVar(0, I-1);
+    auto J = new RangeDepVar(0, minus(I, 1));
     auto problem1 = ProblemBuilder<int>::create()
         .withVar(I)
         .withVar(J)
@@ -54,5 +60,151 @@ int main() {
     auto ans2 = problem2.solve();
     std::cout << "Answer: " << ans2 << std::endl;
     std::cout << "--------------------------------" << std::endl;
+
+    // Example 3: The same problems in the compile-time form, recognized while compiling
+    std::cout << "Example 3: Compile-time LIS, LDS and LCS" << std::endl;
+    using K = ct::Range<0, ct::Dec<ct::I, 1>>;
+    using LISRec = ct::max_<ct::Status<ct::I>,
+                            ct::If<ct::Lt<ct::Seq<0, K>, ct::Seq<0, ct::I>>, ct::Plus<ct::Status<K>, ct::Const<1>>>>;
+    using LDSRec = ct::max_<ct::If<ct::Gt<ct::Seq<0, K>, ct::Seq<0, ct::I>>, ct::Plus<ct::Const<1>, ct::Status<K>>>,
+                            ct::Status<ct::I>>;
+    using LCSRec = ct::Select<ct::Eq<ct::Seq<0, ct::Dec<ct::I, 1>>, ct::Seq<1, ct::Dec<ct::J, 1>>>,
+                              ct::Plus<ct::Status<ct::Dec<ct::I, 1>, ct::Dec<ct::J, 1>>, ct::Const<1>>,
+                              ct::max_<ct::Status<ct::I, ct::Dec<ct::J, 1>>, ct::Status<ct::Dec<ct::I, 1>, ct::J>>>;
+    static_assert(ct::problem_type_v<LISRec> == ProblemType::LIS);
+    static_assert(ct::problem_type_v<LCSRec> == ProblemType::LCS);
+    static_assert(ct::problem_type_v<ct::max_<ct::Status<ct::I>, ct::Const<1>>> == ProblemType::UNKNOWN);
+    std::cout << "LIS answer: " << ct::Program<LISRec>()(Seq->data) << " (expected 6)" << std::endl;
+    std::cout << "LDS answer: " << ct::Program<LDSRec>()(Seq->data) << " (expected 2)" << std::endl;
+    std::cout << "LCS answer: " << ct::Program<LCSRec>(false)(Seq1->data, Seq2->data) << " (expected 3)" << std::endl;
+
+    // Example 4: Post office placement with the cost inlined into the kernel
+    std::cout << "--------------------------------" << std::endl;
+    std::cout << "Example 4: Compile-time convex GLWS" << std::endl;
+    using GLWSRec = ct::min_<ct::Plus<ct::Status<K>, ct::Cost<PostOfficeCost<int>>>>;
+    static_assert(ct::problem_type_v<GLWSRec> == ProblemType::CONVEX_GLWS);
+    std::vector<int> houses = {1, 2, 3, 20, 21, 22};
+    std::cout << "Answer: " << ct::Program<GLWSRec>()(houses, PostOfficeCost<int>(5)) << " (expected 14)" << std::endl;
+    std::cout << "--------------------------------" << std::endl;
+
+    // Example 5: Post office placement through the runtime DSL, with the cost given as a function
+    std::cout << "Example 5: GLWS" << std::endl;
+    auto Houses = new Sequence<int>(houses);
+    auto I5 = new IndVar(0, 6);
+    auto J5 = new RangeDepVar(0, minus(I5, 1));
+    std::vector<int> positions = {0, 1, 2, 3, 20, 21, 22};  // 1-indexed, as ConvexGLWS passes them
+    PostOfficeCost<int> office(5);
+    office.prepare(positions);
+    auto buildProblem5 = [&](bool convex) {
+        return ProblemBuilder<int>::create()
+            .withVar(I5)
+            .withVar(J5)
+            .withSequence(Houses)
+            .withCost([&](int j, int i) { return office(j, i, positions); }, convex)
+            .withCondition(dp_dsl::min(Status(J5) + Cost(J5, I5), Status(I5)))
+            .build();
+    };
+    auto problem5 = buildProblem5(true);
+    detectProblemType(problem5);
+    std::cout << "Answer: " << problem5.solve() << " (expected 14)" << std::endl;
+    auto problem5b = buildProblem5(false);
+    detectProblemType(problem5b);
+    std::cout << "Answer: " << problem5b.solve() << " (expected 14)" << std::endl;
+
+    // Example 6: Lattice paths, evaluated by the generic engine in tiles
+    std::cout << "--------------------------------" << std::endl;
+    std::cout << "Example 6: Lattice paths" << std::endl;
+    auto I6 = new IndVar(0, 10);
+    auto J6 = new IndVar(0, 10);
+    auto problem6 = ProblemBuilder<int>::create()
+        .withVar(I6)
+        .withVar(J6)
+        .withValue("boundary", 1)
+        .withCondition(Status(minus(I6, 1), J6) + Status(I6, minus(J6, 1)))
+        .build();
+    detectProblemType(problem6);
+    std::cout << "Answer: " << problem6.solve() << " (expected 184756)" << std::endl;
+
+    // Example 7: Knapsack where every item weighs 3, evaluated row by row
+    std::cout << "--------------------------------" << std::endl;
+    std::cout << "Example 7: Knapsack" << std::endl;
+    auto Values = new Sequence<int>({5, 1, 4, 2, 8});
+    auto I7 = new IndVar(0, 5);
+    auto C7 = new IndVar(0, 7);
+    auto problem7 = ProblemBuilder<int>::create()
+        .withVar(I7)
+        .withVar(C7)
+        .withSequence(Values)
+        .withCondition(dp_dsl::max(Status(minus(I7, 1), C7),
+                                   Status(minus(I7, 1), minus(C7, 3)) + Element(0, minus(I7, 1))))
+        .build();
+    detectProblemType(problem7);
+    std::cout << "Answer: " << problem7.solve() << " (expected 13)" << std::endl;
+
+    // Example 8: Merging stones, an interval DP evaluated diagonal by diagonal
+    std::cout << "--------------------------------" << std::endl;
+    std::cout << "Example 8: Interval DP" << std::endl;
+    std::vector<int> stones = {4, 1, 1, 4};
+    auto I8 = new IndVar(0, 3);
+    auto J8 = new IndVar(0, 3);
+    auto K8 = new RangeDepVar(I8, minus(J8, 1));
+    auto problem8 = ProblemBuilder<int>::create()
+        .withVar(I8)
+        .withVar(J8)
+        .withVar(K8)
+        .withObjective(Objective::MINIMIZE)
+        .withCost([&](int i, int j) { return std::accumulate(stones.begin() + i, stones.begin() + j + 1, 0); })
+        .withCondition(dp_dsl::min(Status(I8, K8) + Status(add(K8, 1), J8) + Cost(I8, J8), Status(I8, J8)))
+        .withAnswer({0, 3})
+        .build();
+    detectProblemType(problem8);
+    std::cout << "Answer: " << problem8.solve() << " (expected 18)" << std::endl;
+    std::cout << "--------------------------------" << std::endl;
+
+    // Example 9: The LIS and LCS problems above solved for batches of inputs at once
+    std::cout << "Example 9: Batches" << std::endl;
+    auto lisAnswers = problem1.solve_batch({{{3, 1, 4, 2, 7, 5, 8, 6, 9, 10}}, {{5, 4, 3}}, {{1, 2, 3, 4}}});
+    std::cout << "LIS answers: " << lisAnswers[0] << " " << lisAnswers[1] << " " << lisAnswers[2] << " (expected 6 1 4)"
+              << std::endl;
+    auto lcsAnswers = SolverDispatcher::solve_batch(problem2, {{{1, 2, 3, 4, 5}, {3, 1, 4, 2, 5}}, {{1, 1, 1}, {1, 1}}});
+    std::cout << "LCS answers: " << lcsAnswers[0] << " " << lcsAnswers[1] << " (expected 3 2)" << std::endl;
+    std::cout << "--------------------------------" << std::endl;
+
+    // Example 10: LIS where element I weighs Weights[I], solved one dominance layer at a time
+    std::cout << "Example 10: Weighted LIS" << std::endl;
+    auto Values10 = new Sequence<int>({5, 1, 6, 2, 3, 7});
+    auto Weights10 = new Sequence<int>({10, 1, 10, 1, 1, -4});
+    auto I10 = new IndVar(0, 6);
+    auto J10 = new RangeDepVar(0, minus(I10, 1));
+    auto problem10 = ProblemBuilder<int>::create()
+        .withVar(I10)
+        .withVar(J10)
+        .withSequence(Values10)
+        .withSequence(Weights10)
+        .withCondition(dp_dsl::max(Status(J10) + Element(1, I10), Status(I10)))
+        .build();
+    detectProblemType(problem10);
+    std::cout << "Answer: " << problem10.solve() << " (expected 20)" << std::endl;
+    std::cout << "--------------------------------" << std::endl;
+
+    // Example 11: GLWS with a cost that is not convex (ConvexGLWS answers 23), against the quadratic recurrence
+    std::cout << "Example 11: Non-convex GLWS" << std::endl;
+    auto I11 = new IndVar(0, 12);
+    auto J11 = new RangeDepVar(0, minus(I11, 1));
+    auto jagged = [](int j, int i) { return (j * 5 + i * 3) % 7 * ((i - j) % 4) + 2 * ((j + i) % 3) + 1; };
+    auto problem11 = ProblemBuilder<int>::create()
+        .withVar(I11)
+        .withVar(J11)
+        .withCost(jagged)
+        .withCondition(dp_dsl::min(Status(J11) + Cost(J11, I11), Status(I11)))
+        .build();
+    detectProblemType(problem11);
+    std::vector<int> best11(13, 0);
+    for (int i = 1; i <= 12; ++i) {
+        best11[i] = INT_MAX;
+        for (int j = 0; j < i; ++j) best11[i] = std::min(best11[i], best11[j] + jagged(j, i));
+    }
+    std::cout << "Answer: " << problem11.solve() << " (expected " << best11[12] << ")" << std::endl;
+    std::cout << "--------------------------------" << std::endl;
     return 0;
 }
\ No newline at end of file
@@ -6,8 +6,23 @@
 #include "glws.h"
 
 #include <vector>
+#include <atomic>
 #include <cstdlib>
 #include <ctime>
+#include <new>
+
+// Every allocation through operator new, so that tests can check that warm solves do not allocate per state or task
+std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, size_t) noexcept { std::free(p); }
 
 std::vector<long double> generateStrictlyIncreasingArray(int n) {
     std::vector<long double> arr;
@@ -107,6 +122,86 @@ int main() {
     long double result = glws.compute(pos, costFunc);
     long double expected = refSol(pos, buildCost);
     checkTest("GLWS Test", expected, result);
-    
+
+    PostOfficeCost<long double> prefixCost(buildCost);
+    long double prefixResult = glws.compute(pos, prefixCost);
+    checkTest("GLWS Prefix Cost Test", expected, prefixResult);
+
+    ConvexGLWS<long double, PostOfficeCost<long double>> inlinedGlws;
+    long double inlinedResult = inlinedGlws.compute(pos, PostOfficeCost<long double>(buildCost));
+    checkTest("GLWS Inlined Cost Test", expected, inlinedResult);
+
+    ConvexGLWS<long double, PostOfficeCost<long double>> linearGlws(CordonSearch::LINEAR);
+    long double linearResult = linearGlws.compute(pos, PostOfficeCost<long double>(buildCost));
+    checkTest("GLWS Linear Cordon Test", expected, linearResult);
+
+    // The segmentation must start at 0, end at n and cost exactly the optimum
+    std::vector<int> segments = inlinedGlws.compute_segments(pos, PostOfficeCost<long double>(buildCost));
+    std::vector<long double> shifted(1, 0);
+    shifted.insert(shifted.end(), pos.begin(), pos.end());
+    long double segmentCost = 0;
+    for (size_t t = 1; t < segments.size(); ++t) segmentCost += costFunc(segments[t - 1], segments[t], shifted);
+    bool bounded = segments.front() == 0 && segments.back() == static_cast<int>(pos.size());
+    checkTest("GLWS Segments Test", expected, bounded ? segmentCost : -1);
+
+    // The solver keeps its buffers between calls; solving a shorter prefix must not see the longer input
+    for (int n : {300, 1000, 50}) {
+        std::vector<long double> prefix(pos.begin(), pos.begin() + n);
+        checkTest("GLWS Reuse Test " + std::to_string(n), refSol(prefix, buildCost),
+                  inlinedGlws.compute(prefix, PostOfficeCost<long double>(buildCost)));
+    }
+
+    // Appending must match solving every grown prefix from scratch, for an extended cost model and a plain cost, and
+    // when continuing the last compute()
+    ConvexGLWS<long double, PostOfficeCost<long double>> appendedModel;
+    ConvexGLWS<long double> appendedPlain;
+    int appended = 0;
+    for (int chunk : {1, 7, 100, 392, 500}) {
+        std::vector<long double> next(pos.begin() + appended, pos.begin() + appended + chunk);
+        appended += chunk;
+        long double grown = refSol(std::vector<long double>(pos.begin(), pos.begin() + appended), buildCost);
+        checkTest("GLWS Append Test " + std::to_string(appended), grown,
+                  appendedModel.append(next, PostOfficeCost<long double>(buildCost)));
+        checkTest("GLWS Append Plain Test " + std::to_string(appended), grown, appendedPlain.append(next, costFunc));
+    }
+    checkTest("GLWS Append After Compute Test", expected,
+              inlinedGlws.append(std::vector<long double>(pos.begin() + 50, pos.end()),
+                                 PostOfficeCost<long double>(buildCost)));
+
+    // The device rounds must match the host ones, also when appending afterwards; without GPU support, selecting them
+    // must throw
+    std::vector<long long> integral(pos.begin(), pos.end());
+    ConvexGLWS<long long, PostOfficeCost<long long>> hostGlws;
+    ConvexGLWS<long long, PostOfficeCost<long long>> gpuGlws(CordonSearch::BINARY_SEARCH, AUTO_GRANULARITY,
+                                                             ParallelArch::GPU);
+    long long hostResult = hostGlws.compute(integral, PostOfficeCost<long long>(buildCost));
+    if (Gpu::ENABLED && Gpu::device_count() > 0) {
+        checkTest("GLWS GPU Test", hostResult, gpuGlws.compute(integral, PostOfficeCost<long long>(buildCost)));
+        std::vector<long long> more(integral.begin(), integral.begin() + 100);
+        checkTest("GLWS GPU Append Test", hostGlws.append(more, PostOfficeCost<long long>(buildCost)),
+                  gpuGlws.append(more, PostOfficeCost<long long>(buildCost)));
+    } else {
+        bool threw = false;
+        try {
+            gpuGlws.compute(integral, PostOfficeCost<long long>(buildCost));
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        checkTest("GLWS GPU Test", 1, threw);
+    }
+
+    {
+        // With a fine cutoff every round spawns many findIntervals tasks; a warm solve with a prepared cost must only
+        // allocate the prefix sums of the cost (the sums and their block totals), however many tasks it spawns
+        std::vector<long double> many;
+        for (int i = 0; i < 20000; ++i) many.push_back(i * 3 + i % 7);
+        ConvexGLWS<long double, PostOfficeCost<long double>> taskGlws(CordonSearch::BINARY_SEARCH, 16);
+        long double warm = taskGlws.compute(many, PostOfficeCost<long double>(buildCost));
+        size_t before = allocations.load();
+        long double again = taskGlws.compute(many, PostOfficeCost<long double>(buildCost));
+        size_t allocated = allocations.load() - before;
+        checkTest("GLWS Task Allocation Test", 2, warm == again ? allocated : -1);
+    }
+
     return 0;
 }
\ No newline at end of file
@@ -2,10 +2,15 @@
 #include <vector>
 #include <string>
 #include <chrono>
+#include <cstddef>
 #include <cstring>
 #include <cstdlib>
+#include <limits>
+#include <random>
+#include <sstream>
 
 #include "lcs.h"
+#include "lcs_stream.h"
 #include "utils.h"
 #include "data.h"
 #include "parlay/sequence.h"
@@ -18,11 +23,12 @@ void checkTest(const std::string &testName, int expected, int got) {
     }
 }
 
-void testLCS(std::vector<std::vector<int>> &arrows, ParallelArch parallelArch, bool parallel, int granularity, int k) {
+void testLCS(std::vector<std::vector<int>> &arrows, ParallelArch parallelArch, bool parallel, int granularity, int k, bool preorder) {
     std::cout << "--------------------------------" << std::endl;
     LCS<int> lcs;
     auto start = std::chrono::high_resolution_clock::now();
-    int length1 = lcs.compute_arrows(arrows, parallelArch, parallel, granularity);
+    int length1 = preorder ? lcs.compute_arrows<PreorderLayout>(arrows, parallelArch, parallel, granularity)
+                           : lcs.compute_arrows(arrows, parallelArch, parallel, granularity);
     auto end = std::chrono::high_resolution_clock::now();
 
     std::string para = parallel ? "parallel" : "sequential";
@@ -36,6 +42,9 @@ void testLCS(std::vector<std::vector<int>> &arrows, ParallelArch parallelArch, b
             // std::cout << "Cilk " << para << ": " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms" << std::endl;
             checkTest("Cilk " + para + ": ", k, length1 - 1);
             break;
+        case ParallelArch::TOURNAMENT:
+            checkTest("Tournament " + para + ": ", k, length1 - 1);
+            break;
         default:
             std::cout << "Invalid parallel architecture" << std::endl;
             break;
@@ -43,7 +52,7 @@ void testLCS(std::vector<std::vector<int>> &arrows, ParallelArch parallelArch, b
     std::cout << "--------------------------------" << std::endl;
 }
 
-void testLCS_parlay(size_t n, const parlay::sequence<parlay::sequence<size_t>>& arrows, ParallelArch parallelArch, bool parallel, int granularity, int k) {
+void testLCS_parlay(size_t n, const parlay::sequence<parlay::sequence<size_t>>& arrows, ParallelArch parallelArch, bool parallel, int granularity, int k, bool preorder) {
     std::cout << "--------------------------------" << std::endl;
 
     LCS<int> lcs;
@@ -53,14 +62,16 @@ void testLCS_parlay(size_t n, const parlay::sequence<parlay::sequence<size_t>>&
     
     switch (parallelArch) {
         case ParallelArch::PARLAY: {
-            length1 = lcs.compute_arrows_paralay(n, arrows, parallel, granularity);
+            length1 = preorder ? lcs.compute_arrows_paralay<PreorderLayout>(n, arrows, parallel, granularity)
+                               : lcs.compute_arrows_paralay(n, arrows, parallel, granularity);
             auto end1 = std::chrono::high_resolution_clock::now();
             std::cout << "Parlay: " << std::chrono::duration_cast<std::chrono::milliseconds>(end1 - start).count() << "ms" << std::endl;
             checkTest("Parlay: ", k, length1);
             break;
         }
         case ParallelArch::CILK_OPT: {
-            length1 = lcs.compute_arrows_opt(arrows, parallel, granularity);
+            length1 = preorder ? lcs.compute_arrows_opt<PreorderLayout>(arrows, parallel, granularity)
+                               : lcs.compute_arrows_opt(arrows, parallel, granularity);
             auto end2 = std::chrono::high_resolution_clock::now();
             std::cout << "Cilk_opt: " << std::chrono::duration_cast<std::chrono::milliseconds>(end2 - start).count() << "ms" << std::endl;
             checkTest("Cilk_opt: ", k, length1);
@@ -74,12 +85,38 @@ void testLCS_parlay(size_t n, const parlay::sequence<parlay::sequence<size_t>>&
     std::cout << "--------------------------------" << std::endl;
 }
 
+void testLCS_sequences(int n, int m, ParallelArch parallelArch, bool parallel, int granularity) {
+    std::cout << "--------------------------------" << std::endl;
+    // These backends take the sequences rather than the arrows, so compare them with the Cordon rounds on random ones
+    std::mt19937 gen(n + m);
+    std::vector<int> a(n), b(m);
+    for (auto& x : a) x = gen() % 4;
+    for (auto& x : b) x = gen() % 4;
+    LCS<int> lcs;
+    auto start = std::chrono::high_resolution_clock::now();
+    int length = lcs.compute(a, b, parallelArch, parallel, granularity);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::string name = parallelArch == ParallelArch::BIT_PARALLEL ? "Bit-parallel"
+                       : parallelArch == ParallelArch::GPU        ? "GPU"
+                                                                  : "Auto";
+    std::cout << name << ": " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms" << std::endl;
+    // The arrows of these dense inputs only fit in memory for small n and m
+    if (count_arrows(a, b) <= (size_t(1) << 27)) {
+        checkTest(name + ": ", lcs.compute(a, b, ParallelArch::PARLAY, parallel, granularity), length);
+    } else {
+        std::cout << name << ": result is " << length << " (too many arrows to check)" << std::endl;
+    }
+    std::cout << "--------------------------------" << std::endl;
+}
+
 void printUsage() {
-    std::cout << "Usage: ./lcs -n <size1> -m <size2> -k <lcs_length> [-g <granularity>]" << std::endl;
+    std::cout << "Usage: ./lcs -n <size1> -m <size2> -k <lcs_length> [-g <granularity|auto>]" << std::endl;
     std::cout << "  -n: size of first dimension (default: 100000)" << std::endl;
     std::cout << "  -m: size of second dimension (default: 100000)" << std::endl;
     std::cout << "  -k: expected LCS length (default: 10)" << std::endl;
-    std::cout << "  -g: granularity for parallel processing (default: 5000)" << std::endl;
+    std::cout << "  -g: granularity for parallel processing, or auto to tune it (default: 5000)" << std::endl;
+    std::cout << "  -preorder: store the segment tree in pre-order layout (2n - 1 nodes)" << std::endl;
+    std::cout << "  -run: cilk, openmp, parlay, opt, tournament, bitparallel, auto or gpu (default: parlay)" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
@@ -91,6 +128,7 @@ int main(int argc, char* argv[]) {
     ParallelArch parallelArch = ParallelArch::PARLAY;
     bool test_random = false;
     bool parallel = true;
+    bool preorder = false;
 
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
@@ -103,14 +141,16 @@ int main(int argc, char* argv[]) {
             k = atoi(argv[i + 1]);
             i++;
         } else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
-            granularity = atoi(argv[i + 1]);
+            granularity = strcmp(argv[i + 1], "auto") == 0 ? AUTO_GRANULARITY : atoi(argv[i + 1]);
             i++;
         } else if (strcmp(argv[i], "-r") == 0) {
             test_random = true;
         } else if (strcmp(argv[i], "-seq") == 0) {
             parallel = false;
+        } else if (strcmp(argv[i], "-preorder") == 0) {
+            preorder = true;
         } else if (strcmp(argv[i], "-run") == 0 && i + 1 < argc) {
-            // "cilk", "openmp", "parlay"
+            // "cilk", "openmp", "parlay", "opt", "tournament", "bitparallel", "auto", "gpu"
             if (strcmp(argv[i + 1], "cilk") == 0) {
                 parallelArch = ParallelArch::CILK;
             } else if (strcmp(argv[i + 1], "openmp") == 0) {
@@ -119,6 +159,14 @@ int main(int argc, char* argv[]) {
                 parallelArch = ParallelArch::PARLAY;
             } else if (strcmp(argv[i + 1], "opt") == 0) {
                 parallelArch = ParallelArch::CILK_OPT;
+            } else if (strcmp(argv[i + 1], "tournament") == 0) {
+                parallelArch = ParallelArch::TOURNAMENT;
+            } else if (strcmp(argv[i + 1], "bitparallel") == 0) {
+                parallelArch = ParallelArch::BIT_PARALLEL;
+            } else if (strcmp(argv[i + 1], "auto") == 0) {
+                parallelArch = ParallelArch::AUTO;
+            } else if (strcmp(argv[i + 1], "gpu") == 0) {
+                parallelArch = ParallelArch::GPU;
             } else {
                 std::cout << "Invalid parallel architecture: " << argv[i + 1] << std::endl;
                 printUsage();
@@ -138,7 +186,8 @@ int main(int argc, char* argv[]) {
 
     switch (parallelArch) {
         case ParallelArch::CILK:
-        case ParallelArch::OPENMP: {
+        case ParallelArch::OPENMP:
+        case ParallelArch::TOURNAMENT: {
             std::vector<std::vector<int>> arrows;
             if (test_random) {
                 std::cout << "Generating random LCS..." << std::endl;
@@ -147,16 +196,246 @@ int main(int argc, char* argv[]) {
                 std::cout << "Generating LCS..." << std::endl;
                 arrows = MakeData(n, m, k);
             }
-            testLCS(arrows, parallelArch, parallel, granularity, k);
+            testLCS(arrows, parallelArch, parallel, granularity, k, preorder);
             break;
         }
         case ParallelArch::CILK_OPT: 
         case ParallelArch::PARLAY: {
             auto arrows2 = MakeParlayData(n, m, k);
-            testLCS_parlay(n, arrows2, parallelArch, parallel, granularity, k);
+            testLCS_parlay(n, arrows2, parallelArch, parallel, granularity, k, preorder);
             // testLCS_parlay(n, arrows2, false, granularity, k);
             break;
         }
+        case ParallelArch::BIT_PARALLEL:
+        case ParallelArch::AUTO:
+            testLCS_sequences(n, m, parallelArch, parallel, granularity);
+            break;
+        case ParallelArch::GPU:
+            if (!Gpu::ENABLED || Gpu::device_count() == 0) {
+                std::cout << "ParallelArch::GPU needs a CUDA device and the PARALLELDP_GPU build option" << std::endl;
+                return 1;
+            }
+            testLCS_sequences(n, m, parallelArch, parallel, granularity);
+            break;
+    }
+
+    {
+        // The alignment must be as long as the LCS, strictly increasing in both sequences, and match equal symbols
+        std::mt19937 gen(7);
+        std::vector<int> a(3000), b(2000);
+        for (auto& x : a) x = gen() % 4;
+        for (auto& x : b) x = gen() % 4;
+        LCS<int> lcs;
+        // The alignment walks the rounds of a tree, which the bit-parallel and device backends do not have
+        bool hasTree = parallelArch != ParallelArch::BIT_PARALLEL && parallelArch != ParallelArch::GPU;
+        ParallelArch treeArch = hasTree ? parallelArch : ParallelArch::PARLAY;
+        auto alignment = lcs.compute_alignment(a, b, treeArch, parallel, granularity);
+        bool valid = true;
+        for (size_t t = 0; t < alignment.size(); ++t) {
+            auto [i, j] = alignment[t];
+            valid &= a[i] == b[j];
+            if (t > 0) valid &= alignment[t - 1].first < i && alignment[t - 1].second < j;
+        }
+        checkTest("Alignment Test", lcs_dp_naive(a, b), valid ? alignment.size() : -1);
+    }
+
+    {
+        // An empty b and 64-bit values whose span exceeds LLONG_MAX must not take the counting sort
+        int mismatches = 0;
+        ArrowsCSR<> empty = build_arrows(std::vector<int>{1, 2, 3}, std::vector<int>{});
+        mismatches += empty.size() != 3 || empty.nnz() != 0;
+        long long lo = std::numeric_limits<long long>::min(), hi = std::numeric_limits<long long>::max();
+        ArrowsCSR<> wide = build_arrows(std::vector<long long>{hi, 5, lo, 0}, std::vector<long long>{lo, 0, hi, 0});
+        std::vector<std::vector<uint32_t>> expected = {{2}, {}, {0}, {1, 3}};
+        mismatches += wide.size() != expected.size();
+        for (size_t i = 0; i < expected.size() && i < wide.size(); ++i) {
+            std::vector<uint32_t> row(wide.columns_data() + wide.offset(i), wide.columns_data() + wide.offset(i + 1));
+            mismatches += row != expected[i];
+        }
+        checkTest("Arrow Edge Test", 0, mismatches);
+    }
+
+    {
+        // Many short pairs and one outlier that is solved on its own in parallel
+        std::mt19937 gen(11);
+        std::vector<std::vector<int>> first, second;
+        for (int k = 0; k < 300; ++k) {
+            first.emplace_back(1 + gen() % 300);
+            second.emplace_back(1 + gen() % 300);
+        }
+        first.emplace_back(20000);
+        second.emplace_back(15000);
+        for (auto& seq : first) for (auto& x : seq) x = gen() % 8;
+        for (auto& seq : second) for (auto& x : seq) x = gen() % 8;
+        std::vector<int> lengths = LCS<int>::compute_batch(first, second);
+        int mismatches = 0;
+        for (size_t k = 0; k < first.size(); ++k) mismatches += lengths[k] != lcs_dp_naive(first[k], second[k]);
+        checkTest("Batch Test", 0, mismatches);
+    }
+
+    {
+        // Bit-parallel backend and the auto-selector, on dense and sparse arrows and lengths around the word size;
+        // small tiles put several tiles on every anti-diagonal
+        std::mt19937 gen(13);
+        LCS<int> lcs;
+        BitParallelLCS<int> tiled(7, 2);
+        int mismatches = 0;
+        for (int sigma : {4, 1000}) {
+            for (auto [n, m] : {std::pair{1, 1}, {63, 64}, {65, 130}, {1000, 3}, {5000, 3001}}) {
+                std::vector<int> a(n), b(m);
+                for (auto& x : a) x = gen() % sigma;
+                for (auto& x : b) x = gen() % sigma;
+                int expected = lcs_dp_naive(a, b);
+                mismatches += lcs.compute(a, b, ParallelArch::BIT_PARALLEL, parallel) != expected;
+                mismatches += lcs.compute(a, b, ParallelArch::AUTO, parallel) != expected;
+                mismatches += tiled.compute(a, b, true) != expected;
+            }
+        }
+        checkTest("Bit-Parallel Test", 0, mismatches);
+    }
+
+    {
+        // The device rounds must match the host ones; without GPU support, selecting them must throw
+        std::mt19937 gen(17);
+        LCS<int> lcs;
+        int mismatches = 0;
+        for (auto [n, m, sigma] : {std::tuple{1, 1, 1}, {1000, 700, 4}, {3000, 5000, 256}}) {
+            std::vector<int> a(n), b(m);
+            for (auto& x : a) x = gen() % sigma;
+            for (auto& x : b) x = gen() % sigma;
+            if (Gpu::ENABLED && Gpu::device_count() > 0) {
+                mismatches += lcs.compute(a, b, ParallelArch::GPU) != lcs_dp_naive(a, b);
+            } else {
+                try {
+                    lcs.compute(a, b, ParallelArch::GPU);
+                    mismatches++;
+                } catch (const std::runtime_error&) {
+                }
+            }
+        }
+        checkTest("GPU Test", 0, mismatches);
+    }
+
+    {
+        // Binary arrow file: the mapped arrows feed the trees without a copy, and a damaged file is rejected
+        std::mt19937 gen(17);
+        std::vector<int> a(3000), b(2000);
+        for (auto& x : a) x = gen() % 16;
+        for (auto& x : b) x = gen() % 16;
+        std::string path = "arrow_file_test.bin";
+        save_arrows(path, build_arrows(a, b));
+        int expected = lcs_dp_naive(a, b);
+        LCS<int> lcs;
+        ArrowsCSR<> mapped = load_arrows(path);
+        int mismatches = !mapped.is_borrowed();
+        for (ParallelArch arch :
+             {ParallelArch::OPENMP, ParallelArch::CILK, ParallelArch::TOURNAMENT, ParallelArch::PARLAY}) {
+            mismatches += lcs.compute_arrows(mapped, arch, parallel, granularity) != expected;
+        }
+        mismatches += lcs.compute(a, b, ParallelArch::PARLAY, parallel, granularity) != expected;
+
+        // A row count that wraps the size check around must be rejected even without the checksum
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        uint64_t rows = mapped.size() + (uint64_t(1) << 61);
+        file.seekp(offsetof(ArrowFileHeader, rows));
+        file.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+        file.close();
+        try {
+            load_arrows(path, false);
+            mismatches++;
+        } catch (const std::runtime_error&) {
+        }
+
+        save_arrows(path, build_arrows(a, b));
+        file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-1, std::ios::end);
+        file.put('\x7f');
+        file.close();
+        try {
+            load_arrows(path);
+            mismatches++;
+        } catch (const std::runtime_error&) {
+        }
+        std::remove(path.c_str());
+        checkTest("Arrow File Test", 0, mismatches);
+    }
+
+    {
+        // Streaming: A is read in chunks from an iterator and from a binary stream against an index of B, with budgets
+        // small enough to split it into many chunks
+        std::mt19937 gen(19);
+        int mismatches = 0;
+        for (int sigma : {3, 40, 5000}) {
+            std::vector<int> a(5000), b(1500);
+            for (auto& x : a) x = gen() % sigma;
+            for (auto& x : b) x = gen() % sigma;
+            int expected = lcs_dp_naive(a, b);
+            for (size_t budget : {3000, 100000}) {
+                StreamingLCS<int> stream(b, budget, parallel, granularity);
+                stream.append(a.begin(), a.begin() + 2500);
+                stream.append(a.begin() + 2500, a.end());
+                mismatches += stream.length() != expected;
+
+                stream.clear();
+                std::stringstream file(std::string(reinterpret_cast<const char*>(a.data()), a.size() * sizeof(int)));
+                stream.append(file, 333);
+                mismatches += stream.length() != expected;
+            }
+        }
+        checkTest("Streaming Test", 0, mismatches);
+    }
+
+    {
+        // With PARALLELDP_STATS, a solve records one round per unit of LCS length and finalizes every arrow once;
+        // without it, nothing is recorded
+        std::mt19937 gen(23);
+        std::vector<int> a(3000), b(2000);
+        for (auto& x : a) x = gen() % 16;
+        for (auto& x : b) x = gen() % 16;
+        Stats::clear();
+        LCS<int> lcs;
+        int length = lcs.compute(a, b, ParallelArch::PARLAY, parallel, granularity);
+        int mismatches = 0;
+        if (Stats::ENABLED) {
+            const Stats::SolveRecord& solve = Stats::solves().back();
+            uint64_t finalized = 0;
+            for (const auto& round : solve.rounds) finalized += round.frontier;
+            mismatches += solve.solver != "lcs" || static_cast<int>(solve.rounds.size()) != length;
+            mismatches += finalized != count_arrows(a, b);
+            std::stringstream json, trace;
+            Stats::write_json(json);
+            Stats::write_trace(trace);
+            mismatches += json.str().find("\"rounds\"") == std::string::npos;
+            mismatches += trace.str().find("\"round 1\"") == std::string::npos;
+        } else {
+            mismatches += !Stats::solves().empty();
+        }
+        checkTest("Stats Test", 0, mismatches);
+    }
+
+    {
+        // Weighted matches against the quadratic DP, with negative weights that a common subsequence should skip
+        std::mt19937 gen(29);
+        int mismatches = 0;
+        for (int sigma : {2, 8, 64}) {
+            std::vector<int> a(700), b(500);
+            for (auto& x : a) x = gen() % sigma;
+            for (auto& x : b) x = gen() % sigma;
+            auto weight = [&](int i, int j) { return static_cast<long long>((i * 31 + j * 17) % 23) - 5; };
+            std::vector<std::vector<long long>> dp(a.size() + 1, std::vector<long long>(b.size() + 1, 0));
+            long long best = 0;
+            for (size_t i = 1; i <= a.size(); ++i) {
+                for (size_t j = 1; j <= b.size(); ++j) {
+                    dp[i][j] = std::max(dp[i - 1][j], dp[i][j - 1]);
+                    if (a[i - 1] == b[j - 1]) dp[i][j] = std::max(dp[i][j], dp[i - 1][j - 1] + weight(i - 1, j - 1));
+                    best = std::max(best, dp[i][j]);
+                }
+            }
+            LCS<int> lcs;
+            mismatches += lcs.compute_weighted(a, b, weight, parallel, granularity) != best;
+            mismatches += lcs.compute_weighted(a, b, [](int, int) { return 1; }, parallel) != lcs_dp_naive(a, b);
+        }
+        checkTest("Weighted Test", 0, mismatches);
     }
 
     std::cout << "Test Finished." << std::endl;
@@ -0,0 +1,61 @@
+#include <mpi.h>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "lcs.h"
+#include "lcs_mpi.h"
+#include "tournament_tree.h"
+#include "utils.h"
+
+// Run with mpirun -np <ranks>; every rank generates the same inputs, rank 0 reports
+void checkTest(int rank, const std::string &testName, int expected, int got) {
+    if (rank != 0) return;
+    if (expected != got) {
+        std::cout << testName << " Fail: expected: " << expected << ", got " << got << std::endl;
+    } else {
+        std::cout << testName << " Pass: result is " << got << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    MPI_Init(&argc, &argv);
+    int rank = 0, ranks = 1;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+    bool parallel = true;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "-seq") parallel = false;
+    }
+
+    {
+        // Rows split evenly, then by arrow count, against the quadratic DP and the shared-memory rounds; the small
+        // and empty inputs leave some ranks without rows
+        std::mt19937 gen(41);
+        DistributedLCS<> lcs;
+        DistributedLCS<TournamentTree<int, OpenMPScheduler>> tournament;
+        int mismatches = 0;
+        for (auto [n, m, sigma] : {std::tuple<int, int, int>{1000, 800, 4}, {2000, 1500, 64}, {600, 3000, 2},
+                                   {3, 50, 2}, {1, 1, 1}, {0, 10, 2}, {10, 0, 2}}) {
+            std::vector<int> a(n), b(m);
+            for (auto& x : a) x = gen() % sigma;
+            for (auto& x : b) x = gen() % sigma;
+            int expected = lcs_dp_naive(a, b);
+            mismatches += lcs.compute(a, b, parallel) != expected;
+            mismatches += tournament.compute(a, b, parallel, 16) != expected;
+
+            ArrowsCSR<> arrows = build_arrows(a, b);
+            LCS<int> reference;
+            mismatches += lcs.compute_arrows(arrows, parallel) != reference.compute_arrows_paralay(arrows, parallel);
+            std::vector<size_t> bounds = DistributedLCS<>::partition(arrows, ranks);
+            for (int p = 0; p < ranks; ++p) mismatches += bounds[p] > bounds[p + 1];
+            mismatches += bounds[0] != 0 || bounds[ranks] != arrows.size();
+        }
+        checkTest(rank, "Distributed Test", 0, mismatches);
+    }
+
+    if (rank == 0) std::cout << "Test Finished." << std::endl;
+    MPI_Finalize();
+    return 0;
+}
\ No newline at end of file
@@ -1,11 +1,30 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
 #include <iostream>
+#include <new>
 #include <vector>
 #include <string>
 #include <random>
 #include "lis.h"
+#include "solver_context.h"
+#include "tournament_tree.h"
 #include "utils.h"
 #include <chrono>
 
+// Every allocation through operator new, so that tests can check that warm solves do not allocate
+std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
 void checkTest(const std::string &testName, int expected, int got) {
     if (expected != got) {
         std::cout << testName << " Fail: expected: " << expected << ", got " << got << std::endl;
@@ -111,14 +130,193 @@ int main() {
         // checkTest("Performance Test", refLength, length);
 
         auto start3 = std::chrono::high_resolution_clock::now();
-        int refLength = refSol(input);
+        int refLength = lis_patience(input);
         auto end3 = std::chrono::high_resolution_clock::now();
-        std::cout << "Time taken in naive: " << std::chrono::duration_cast<std::chrono::milliseconds>(end3 - start3).count() << "ms" << std::endl;
+        std::cout << "Time taken in patience sorting: " << std::chrono::duration_cast<std::chrono::milliseconds>(end3 - start3).count() << "ms" << std::endl;
 
         checkTest("Performance Test", refLength, length);
         checkTest("Performance Test", refLength, length2);
     }
 
+    {
+        // Many duplicates, so that whole runs of equal values share a frontier round
+        std::vector<int> randomData = generateRandomInputData(5000, 1, 100);
+        LIS<int> lis;
+        checkTest("Random Test", refSol(randomData), lis.compute(randomData, true, 64));
+    }
+
+    {
+        std::vector<int> randomData = generateRandomInputData(5000, 1, 100);
+        LIS<int, std::less<int>, TournamentTree<int>> lis;
+        checkTest("Tournament Test", refSol(randomData), lis.compute(randomData, true, 64));
+    }
+
+    {
+        // The witness must be as long as the LIS and strictly increasing in both index and value
+        std::vector<int> randomData = generateRandomInputData(5000, 1, 1000);
+        LIS<int> lis;
+        std::vector<int> witness = lis.compute_subsequence(randomData, true, 64);
+        bool increasing = true;
+        for (size_t k = 1; k < witness.size(); ++k) {
+            increasing &= witness[k - 1] < witness[k] && randomData[witness[k - 1]] < randomData[witness[k]];
+        }
+        checkTest("Subsequence Test", refSol(randomData), increasing ? witness.size() : -1);
+    }
+
+    {
+        // Inputs that grow and shrink, so the trees are rebuilt in place over storage left by larger ones
+        SolverContext<int> context;
+        LIS<int, std::less<int>, TournamentTree<int>> tournament;
+        int mismatches = 0;
+        for (int n : {3000, 500, 5000, 1, 2000}) {
+            std::vector<int> randomData = generateRandomInputData(n, 1, 1000);
+            int expected = refSol(randomData);
+            mismatches += context.lis.compute(randomData, true, 64) != expected;
+            mismatches += tournament.compute(randomData, true, 64) != expected;
+        }
+        checkTest("Reuse Test", 0, mismatches);
+    }
+
+    {
+        // Back-to-back solves of a warm context, at the largest sizes and below, must not allocate
+        std::mt19937 gen(37);
+        SolverContext<int> context;
+        std::vector<int> sequence = generateRandomInputData(5000, 1, 1000), a(4000), b(3000), positions(2000);
+        for (auto& x : a) x = gen() % 4;
+        for (auto& x : b) x = gen() % 4;
+        for (int i = 0, x = 0; i < 2000; ++i) positions[i] = x += 1 + gen() % 5;
+        GLWSCostFunction<int> cost = [](int j, int i, const std::vector<int>& pos) {
+            return (pos[i] - pos[j + 1]) * (pos[i] - pos[j + 1]) / 16 + 40;
+        };
+        std::vector<int> shortSequence(sequence.begin(), sequence.begin() + 1000);
+        std::vector<int> shortB(b.begin(), b.begin() + 500), shortPositions(positions.begin(), positions.begin() + 300);
+        auto solve = [&](int* lengths) {
+            lengths[0] = context.lis.compute(sequence, true, 64);
+            lengths[1] = context.lcs.compute(a, b, ParallelArch::PARLAY, true, 64);
+            lengths[2] = context.glws.compute(positions, cost);
+            lengths[3] = context.lis.compute(shortSequence, true, 64);
+            lengths[4] = context.lcs.compute(a, shortB, ParallelArch::PARLAY, true, 64);
+            lengths[5] = context.glws.compute(shortPositions, cost);
+        };
+        int expected[6], got[6];
+        solve(expected);
+        solve(expected);
+        size_t before = allocations.load();
+        solve(got);
+        size_t allocated = allocations.load() - before;
+        checkTest("Allocation Test", 0, std::equal(got, got + 6, expected) ? allocated : -1);
+    }
+
+    {
+        // Many short inputs and one outlier that is solved on its own in parallel
+        std::vector<std::vector<int>> inputs;
+        for (int k = 0; k < 500; ++k) inputs.push_back(generateRandomInputData(1 + k % 200, 1, 1000));
+        inputs.push_back(generateLIS(200000, 50));
+        std::vector<int> lengths = LIS<int>::compute_batch(inputs);
+        int mismatches = 0;
+        for (size_t k = 0; k < inputs.size(); ++k) mismatches += lengths[k] != lis_patience(inputs[k]);
+        checkTest("Batch Test", 0, mismatches);
+    }
+
+    {
+        // Appended chunks of all sizes, so that both the Cordon rounds and the binary search update the tails
+        std::vector<int> grown;
+        LIS<int> appended, sequential;
+        int mismatches = 0;
+        for (int chunk : {1, 2000, 3, 500, 5000, 40, 10000}) {
+            std::vector<int> next = generateRandomInputData(chunk, 1, 3000);
+            grown.insert(grown.end(), next.begin(), next.end());
+            mismatches += appended.append(next, true, 64) != lis_patience(grown);
+            mismatches += sequential.append(next) != lis_patience(grown);
+        }
+        appended.clear();
+        mismatches += appended.append(grown, true, 64) != lis_patience(grown) || appended.length() != lis_patience(grown);
+        checkTest("Append Test", 0, mismatches);
+    }
+
+    {
+        // Weighted inputs with duplicates and negative weights, on both trees
+        std::mt19937 gen(31);
+        LIS<int> lis;
+        LIS<int, std::less<int>, TournamentTree<int>> tournament;
+        int mismatches = 0;
+        for (int n : {1, 100, 5000, 20000}) {
+            std::vector<int> data = generateRandomInputData(n, 1, n / 4 + 1);
+            std::vector<long long> weights(n);
+            for (auto& w : weights) w = static_cast<long long>(gen() % 1000) - 100;
+            long long expected = lis_weighted_fenwick(data, weights);
+            mismatches += lis.compute_weighted(data, weights, true, 64) != expected;
+            mismatches += lis.compute_weighted(data, weights) != expected;
+            mismatches += tournament.compute_weighted(data, weights, true, 64) != expected;
+        }
+        std::vector<int> ones(3000, 1);
+        std::vector<int> data = generateRandomInputData(3000, 1, 1000);
+        mismatches += lis.compute_weighted(data, ones, true, 64) != refSol(data);
+
+        // Under std::greater the weighted LIS is the one of the negated input under std::less
+        LIS<int, std::greater<int>> greater;
+        std::vector<int> descending = {5, 4, 3, 2, 1};
+        mismatches += greater.compute_weighted(descending, std::vector<int>(5, 1), false, 0, std::greater<int>()) != 5;
+        mismatches += greater.compute_subsequence(descending, false, 0, std::greater<int>()).size() != 5;
+        for (int n : {1, 100, 3000}) {
+            std::vector<int> data = generateRandomInputData(n, 1, n / 4 + 1), negated(n);
+            std::vector<long long> weights(n);
+            for (auto& w : weights) w = static_cast<long long>(gen() % 1000) - 100;
+            for (int i = 0; i < n; ++i) negated[i] = -data[i];
+            long long expected = lis_weighted_fenwick(negated, weights);
+            mismatches += greater.compute_weighted(data, weights, true, 64, std::greater<int>()) != expected;
+            mismatches += greater.compute_weighted(data, weights, false, 0, std::greater<int>()) != expected;
+        }
+        checkTest("Weighted Test", 0, mismatches);
+    }
+
+    {
+        // A comparator other than std::less takes the general-order rounds and their parallel relaxation
+        auto less = [](int a, int b) { return a < b; };
+        LIS<int, decltype(less)> lis;
+        int mismatches = 0;
+        for (int n : {1, 63, 1000, 5000}) {
+            std::vector<int> randomData = generateRandomInputData(n, 1, 300);
+            mismatches += lis.compute(randomData, true, 0, less) != refSol(randomData);
+            mismatches += lis.compute(randomData, true, 64, less) != refSol(randomData);
+            mismatches += lis.compute(randomData, false, 0, less) != refSol(randomData);
+        }
+        checkTest("Relaxation Test", 0, mismatches);
+    }
+
+    {
+        // std::greater must find the longest decreasing subsequence, not only reject an ascending input
+        LIS<int, std::greater<int>> lis;
+        int mismatches = lis.compute({1, 2, 3, 4, 5}, false, 0, std::greater<int>()) != 1;
+        mismatches += lis.compute({5, 4, 3, 2, 1}, false, 0, std::greater<int>()) != 5;
+        mismatches += lis.compute({5, 4, 3, 2, 1}, true, 1, std::greater<int>()) != 5;
+        for (int n : {10, 300, 3000}) {
+            std::vector<int> randomData = generateRandomInputData(n, 1, n / 2 + 1), negated(n);
+            for (int i = 0; i < n; ++i) negated[i] = -randomData[i];
+            mismatches += lis.compute(randomData, true, 64, std::greater<int>()) != refSol(negated);
+            mismatches += lis.compute(randomData, false, 0, std::greater<int>()) != refSol(negated);
+        }
+
+        // Ranked by cmp, std::greater takes one round per LIS length like std::less
+        std::vector<int> randomData = generateRandomInputData(5000, 1, 1000), negated(5000);
+        for (int i = 0; i < 5000; ++i) negated[i] = -randomData[i];
+        Stats::clear();
+        int length = lis.compute(randomData, true, 64, std::greater<int>());
+        mismatches += length != lis_patience(negated);
+        if (Stats::ENABLED) mismatches += static_cast<int>(Stats::solves().back().rounds.size()) != length;
+
+        // 256 classes leave no infinity in uint8_t, so these take the rounds that finalize one state each
+        std::vector<uint8_t> bytes(3000);
+        std::vector<int> flipped(3000);
+        for (int i = 0; i < 3000; ++i) {
+            bytes[i] = static_cast<uint8_t>(i * 37 % 256);
+            flipped[i] = -bytes[i];
+        }
+        LIS<uint8_t, std::greater<uint8_t>> byteLis;
+        mismatches += byteLis.compute(bytes, true, 64, std::greater<uint8_t>()) != lis_patience(flipped);
+        checkTest("Greater Test", 0, mismatches);
+    }
+
     std::cout << "Test Finished." << std::endl;
     return 0;
 }
\ No newline at end of file